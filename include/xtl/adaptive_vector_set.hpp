@@ -0,0 +1,369 @@
+#ifndef ADAPTIVE_VECTOR_SET_5F0E7C2B_8D14_4A63_B9E2_1C7A4D3F6B05
+#define ADAPTIVE_VECTOR_SET_5F0E7C2B_8D14_4A63_B9E2_1C7A4D3F6B05
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	An integer set which switches between a bitmap and a sparse set.
+/// @author Paul Glendenning
+/// @date
+
+#include <iterator>
+#include <utility>
+#include "property.hpp"
+#include "bitmap.hpp"
+#include "unordered_vector_set.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// Representation policy for adaptive_vector_set. The set is held as a bitmap
+/// when size()*DenseRatio >= domain, and returns to the sparse layout when
+/// size()*SparseRatio < domain. The gap between the ratios stops the set
+/// thrashing between layouts when its size hovers near one threshold.
+///
+/// The bitmap costs one bit per domain slot. The sparse layout costs 4 bytes per
+/// domain slot for its index plus sizeof(Key) per element, so the bitmap is the
+/// smaller layout at every density. The sparse layout is chosen only for speed:
+/// iteration and clear() on a bitmap cost O(domain/64) rather than O(size()),
+/// which dominates when the set is very sparse. The defaults switch to the
+/// bitmap once there is more than one key per 32 domain slots.
+template<unsigned DenseRatio=32, unsigned SparseRatio=128>
+struct density_set_policy
+{
+	static bool use_dense(size_t size, size_t domain, bool dense)
+	{
+		return dense? (size*SparseRatio >= domain): (size*DenseRatio >= domain);
+	}
+};
+
+/// Policy which always uses the bitmap layout.
+struct dense_set_policy
+{
+	static bool use_dense(size_t, size_t, bool) { return true; }
+};
+
+/// Policy which always uses the sparse layout. This behaves as a plain
+/// unordered_vector_set.
+struct sparse_set_policy
+{
+	static bool use_dense(size_t, size_t, bool) { return false; }
+};
+
+/// @cond
+template<class Set>
+class adaptive_vector_set_iterator: public std::iterator<std::forward_iterator_tag, const typename Set::key_type>
+{
+	template<class K, class P, class A> friend class adaptive_vector_set;
+	typedef typename Set::sparse_type::const_iterator sparse_iterator;
+
+	const Set*		_owner;
+	sparse_iterator	_it;
+	size_t			_pos;
+
+	adaptive_vector_set_iterator(const Set* owner, sparse_iterator it): _owner(owner), _it(it), _pos(0) { }
+	adaptive_vector_set_iterator(const Set* owner, size_t pos): _owner(owner), _it(), _pos(pos) { }
+public:
+	adaptive_vector_set_iterator(): _owner(0), _it(), _pos(0) { }
+
+	/// Keys are not stored as objects in the bitmap layout, so dereference
+	/// returns by value.
+	typename Set::key_type operator * () const
+	{
+		return _owner->_isDense? typename Set::key_type(_pos): *_it;
+	}
+	adaptive_vector_set_iterator& operator ++ ()
+	{
+		if (_owner->_isDense)
+			_pos = _owner->_dense.find_next(_pos+1);
+		else
+			++_it;
+		return *this;
+	}
+	adaptive_vector_set_iterator operator ++ (int)
+	{
+		adaptive_vector_set_iterator prev(*this);
+		++*this;
+		return prev;
+	}
+	bool operator == (const adaptive_vector_set_iterator& other) const
+	{
+		return _owner->_isDense? _pos == other._pos: _it == other._it;
+	}
+	bool operator != (const adaptive_vector_set_iterator& other) const { return !(*this == other); }
+};
+/// @endcond
+
+/// An adaptive_vector_set is an unordered set of integers which is held either
+/// as a bitmap over the key domain or as an unordered_vector_set, as chosen
+/// by the Policy from the measured density. Conversion between the layouts
+/// happens in insert() and erase() and costs O(domain/64 + size()).
+///
+/// Switching to the sparse layout never saves memory, since its index also
+/// spans the domain. Use dense_set_policy where memory matters more than the
+/// cost of iterating a sparse set.
+///
+/// Iterators are invalidated by insert() and erase() since either can change
+/// the layout.
+///
+/// @param Key		The key type. Must be an integer type.
+/// @param Policy	The representation policy, see density_set_policy.
+/// @param Alloc	Allocator function.
+/// @remarks The time complexity for insert, erase, and test is O(1) in either
+/// layout, excluding conversions.
+template<class Key, class Policy=density_set_policy<>, class Alloc=std::allocator<Key> >
+class adaptive_vector_set
+{
+public:
+	typedef Key					key_type;
+	typedef Key					value_type;
+	typedef unordered_vector_set<Key, Alloc> sparse_type;
+	typedef bitmap<uint64_t, typename Alloc::template rebind<uint64_t>::other> bitmap_type;
+	typedef adaptive_vector_set_iterator<adaptive_vector_set>	const_iterator;
+	typedef const_iterator										iterator;
+	typedef bool (*key_compare)(const key_type& a, const key_type& b);
+	typedef bool (*value_compare)(const value_type& a, const value_type& b);
+private:
+	/// @cond
+	friend class adaptive_vector_set_iterator<adaptive_vector_set>;
+
+	sparse_type		_sparse;
+	bitmap_type		_dense;
+	// The number of keys in _dense
+	size_t			_denseSize;
+	// The key domain, one more than the largest key reserved
+	size_t			_domain;
+	bool			_isDense;
+
+	void to_dense()
+	{
+		_dense.resize(_domain);
+		for (typename sparse_type::const_iterator i=_sparse.begin(); i!=_sparse.end(); ++i)
+			_dense.set(size_t(*i));
+		_denseSize = _sparse.size();
+		sparse_type().swap(_sparse);
+		_isDense = true;
+	}
+
+	void to_sparse()
+	{
+		_sparse.reserve(_domain);
+		for (size_t i=_dense.find_next(0); i!=bitmap_type::npos; i=_dense.find_next(i+1))
+			_sparse.insert(key_type(i));
+		bitmap_type().swap(_dense);
+		_denseSize = 0;
+		_isDense = false;
+	}
+
+	void adapt()
+	{
+		bool dense = Policy::use_dense(size(), _domain, _isDense);
+		if (dense != _isDense)
+		{
+			if (dense) to_dense(); else to_sparse();
+		}
+	}
+
+	static bool compare(const key_type& a, const key_type& b)
+	{
+		return a < b;
+	}
+	/// @endcond
+
+public:
+	/// Create an adaptive_vector_set for keys in [0,N).
+	adaptive_vector_set(size_t N=0): _denseSize(0), _domain(0), _isDense(false)
+	{
+		reserve(N);
+		if (Policy::use_dense(0, _domain, false)) to_dense();
+	}
+
+	/// Reserve space for keys in [0,N).
+	void reserve(size_t N)
+	{
+		if (N <= _domain) return;
+		_domain = N;
+		if (_isDense)
+			_dense.resize(N);
+		else
+			_sparse.reserve(N);
+	}
+
+	/// @return True if the bitmap layout is in use.
+	bool dense() const { return _isDense; }
+
+	/// Get the key domain.
+	size_t capacity() const { return _domain; }
+
+	/// @{
+	/// STL container properties
+	size_t size() const { return _isDense? _denseSize: _sparse.size(); }
+	bool empty() const { return size() == 0; }
+	/// @}
+
+	/// Get the heap memory held by both representations. In the dense layout
+	/// the bitmap is the payload.
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _sparse.memory_usage();
+		memory_usage_info bits = _dense.memory_usage();
+		if (_isDense)
+			info.payload += bits.index;
+		else
+			info.index += bits.index;
+		return info;
+	}
+
+	/// STL pattern compatible with std::set<>. Remove all items. The layout
+	/// is kept.
+	/// @remarks Complexity O(domain/64) in the bitmap layout, otherwise O(1).
+	void clear()
+	{
+		if (_isDense)
+		{
+			_dense.clear();
+			_denseSize = 0;
+		}
+		else
+			_sparse.clear();
+	}
+
+	/// STL pattern compatible with std::set<>
+	void swap(adaptive_vector_set& other)
+	{
+		_sparse.swap(other._sparse);
+		_dense.swap(other._dense);
+		std::swap(_denseSize, other._denseSize);
+		std::swap(_domain, other._domain);
+		std::swap(_isDense, other._isDense);
+	}
+
+	/// @{
+	/// STL iterator patterns compatible with std::set<>. The bitmap layout
+	/// iterates in key order.
+	const_iterator begin() const
+	{
+		return _isDense? const_iterator(this, _dense.find_next(0)): const_iterator(this, _sparse.begin());
+	}
+	const_iterator end() const
+	{
+		return _isDense? const_iterator(this, bitmap_type::npos): const_iterator(this, _sparse.end());
+	}
+	/// @}
+
+	/// STL pattern compatible with std::set<>
+	/// @remarks Complexity O(1), excluding a layout conversion.
+	std::pair<const_iterator, bool> insert(key_type key)
+	{
+		if (!(size_t(key) < _domain))
+			reserve(size_t(key)+1);
+		bool inserted;
+		if (_isDense)
+		{
+			inserted = !_dense.test(size_t(key));
+			if (inserted)
+			{
+				_dense.set(size_t(key));
+				++_denseSize;
+			}
+		}
+		else
+			inserted = _sparse.insert(key).second;
+		if (inserted)
+			adapt();
+		return std::make_pair(find(key), inserted);
+	}
+
+	/// STL pattern compatible with std::set<>
+	/// @return	The number of keys erased.
+	/// @remarks Complexity O(1), excluding a layout conversion.
+	size_t erase(key_type key)
+	{
+		if (!test(key))
+			return 0;
+		if (_isDense)
+		{
+			_dense.reset(size_t(key));
+			--_denseSize;
+		}
+		else
+			_sparse.erase(key);
+		adapt();
+		return 1;
+	}
+
+	/// Check if a key exists in the set.
+	/// @remarks Complexity O(1).
+	bool test(key_type key) const
+	{
+		if (_isDense)
+			return size_t(key) < _dense.size() && _dense.test(size_t(key));
+		return _sparse.test(key);
+	}
+
+	/// STL pattern compatible with std::set<>
+	size_t count(key_type key) const { return test(key)? 1: 0; }
+
+	/// Count the keys in [first,last).
+	/// @remarks Complexity O((last-first)/64) in the bitmap layout, otherwise
+	/// O(size()).
+	size_t count(key_type first, key_type last) const
+	{
+		if (_isDense)
+			return _dense.count(std::min(size_t(first), _dense.size()), std::min(size_t(last), _dense.size()));
+		size_t n = 0;
+		for (typename sparse_type::const_iterator i=_sparse.begin(); i!=_sparse.end(); ++i)
+			n += (*i >= first && *i < last)? 1: 0;
+		return n;
+	}
+
+	/// STL pattern compatible with std::set<>
+	/// @remarks Complexity O(1).
+	const_iterator find(key_type key) const
+	{
+		if (_isDense)
+			return const_iterator(this, test(key)? size_t(key): bitmap_type::npos);
+		return const_iterator(this, _sparse.find(key));
+	}
+
+	/// Required for XTL set operations
+	static key_compare key_comp() { return compare; }
+	static value_compare value_comp() { return compare; }
+};
+
+/// Adaptive vector set traits
+template<class K, class P, class A>
+struct container_traits<adaptive_vector_set<K,P,A> >: public __set_traits<adaptive_vector_set<K,P,A> >
+{
+	typedef associative_container_tag category;
+	UNSUPPORTED_PROPERTY(allow_duplicate_keys);
+	UNSUPPORTED_PROPERTY(sorted);
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(ADAPTIVE_VECTOR_SET_5F0E7C2B_8D14_4A63_B9E2_1C7A4D3F6B05)
@@ -0,0 +1,263 @@
+#ifndef BITMAP_0130B610_1DFE_4C99_99CD_C58E161FA0FC
+#define BITMAP_0130B610_1DFE_4C99_99CD_C58E161FA0FC
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Fixed domain bitmap with fast scanning for set bits.
+/// @author Paul Glendenning
+/// @date
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include "property.hpp"
+#include "bitmagic.hpp"
+#include "memory.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// A bitmap over the integer domain [0,size()). Scanning for set bits skips
+/// whole words so iterating a range of R bits containing H set bits costs
+/// O(R/word_bits + H).
+///
+/// @param Word		The word type. Must have a bitmagic<> specialization.
+/// @param Alloc	The word allocator.
+template<class Word=uint64_t, class Alloc=std::allocator<Word> >
+class bitmap
+{
+public:
+	typedef Word								word_type;
+	typedef std::vector<Word,Alloc>				vector_type;
+	static const size_t npos = ~size_t(0);
+
+	/// Iterates the indexes of set bits in increasing order.
+	/// @remarks Models a forward iterator.
+	class const_iterator: public std::iterator<std::forward_iterator_tag, const size_t>
+	{
+		/// @cond
+		friend class bitmap;
+		const bitmap* _owner;
+		size_t _pos;
+		const_iterator(const bitmap* owner, size_t pos): _owner(owner), _pos(pos) { }
+		/// @endcond
+	public:
+		const_iterator(): _owner(0), _pos(npos) { }
+		size_t operator * () const { return _pos; }
+		const_iterator& operator ++ ()
+		{
+			_pos = _owner->find_next(_pos+1);
+			return *this;
+		}
+		const_iterator operator ++ (int)
+		{
+			const_iterator prev(*this);
+			_pos = _owner->find_next(_pos+1);
+			return prev;
+		}
+		bool operator == (const const_iterator& other) const { return _pos == other._pos; }
+		bool operator != (const const_iterator& other) const { return _pos != other._pos; }
+	};
+	typedef const_iterator iterator;
+
+private:
+	/// @cond
+	typedef bitmagic<Word> magic;
+	vector_type		_words;
+	size_t			_size;
+	/// @endcond
+
+public:
+	/// Create a bitmap of n zero bits.
+	bitmap(size_t n=0): _size(0) { resize(n); }
+
+	/// @return	The number of bits in the domain.
+	size_t size() const { return _size; }
+
+	/// @return	The number of words used for storage.
+	size_t words() const { return _words.size(); }
+
+	/// Get the heap memory held by the bitmap. All of it is counted as index.
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info;
+		info.index = _words.capacity()*sizeof(Word);
+		return info;
+	}
+
+	/// Change the domain size. New bits are zero.
+	void resize(size_t n)
+	{
+		_words.resize((n + magic::word_bits - 1) >> magic::shift_size, Word(0));
+		_size = n;
+		// Keep the bits past the end of the domain zero
+		if (n & (magic::word_bits-1))
+			_words.back() &= magic::set(0, n & (magic::word_bits-1));
+	}
+
+	/// Release unused storage.
+	void shrink_to_fit() { _words.shrink_to_fit(); }
+
+	/// Set all bits to zero.
+	/// @remarks Complexity O(size()/word_bits).
+	void clear() { std::fill(_words.begin(), _words.end(), Word(0)); }
+
+	/// @{
+	/// Single bit access.
+	/// @remarks Complexity O(1).
+	bool test(size_t i) const
+	{
+		XTL_ITERATOR_ASSERT1(i < _size);
+		return magic::test(_words[i >> magic::shift_size], i & (magic::word_bits-1));
+	}
+	void set(size_t i)
+	{
+		XTL_ITERATOR_ASSERT1(i < _size);
+		_words[i >> magic::shift_size] |= Word(1) << (i & (magic::word_bits-1));
+	}
+	void reset(size_t i)
+	{
+		XTL_ITERATOR_ASSERT1(i < _size);
+		_words[i >> magic::shift_size] &= ~(Word(1) << (i & (magic::word_bits-1)));
+	}
+	/// @}
+
+	/// Find the first set bit at or after i.
+	/// @return	The bit index, or npos if there is none.
+	/// @remarks Complexity O((result-i)/word_bits).
+	size_t find_next(size_t i) const
+	{
+		if (i >= _size) return npos;
+		size_t w = i >> magic::shift_size;
+		Word m = _words[w] & magic::set(i & (magic::word_bits-1));
+		while (!m)
+		{
+			if (++w == _words.size()) return npos;
+			m = _words[w];
+		}
+		return (w << magic::shift_size) + magic::tzc(m);
+	}
+
+	/// Count the set bits in [first,last).
+	/// @remarks Complexity O((last-first)/word_bits).
+	size_t count(size_t first, size_t last) const
+	{
+		last = std::min(last, _size);
+		if (first >= last) return 0;
+		size_t wf = first >> magic::shift_size;
+		size_t wl = (last - 1) >> magic::shift_size;
+		Word lo = magic::set(first & (magic::word_bits-1));
+		Word hi = magic::set(0, ((last - 1) & (magic::word_bits-1)) + 1);
+		if (wf == wl)
+			return magic::ones(_words[wf] & lo & hi);
+		size_t n = magic::ones(_words[wf] & lo) + magic::ones(_words[wl] & hi);
+		for (size_t w=wf+1; w<wl; ++w)
+			n += magic::ones(_words[w]);
+		return n;
+	}
+
+	/// Count all set bits.
+	/// @remarks Complexity O(size()/word_bits).
+	size_t count() const { return count(0, _size); }
+
+	/// Exchange contents with other.
+	void swap(bitmap& other)
+	{
+		_words.swap(other._words);
+		std::swap(_size, other._size);
+	}
+
+	/// @{
+	/// Iterate the indexes of set bits.
+	const_iterator begin() const { return const_iterator(this, find_next(0)); }
+	const_iterator end() const { return const_iterator(this, npos); }
+	const_iterator lower_bound(size_t i) const { return const_iterator(this, find_next(i)); }
+	const_iterator upper_bound(size_t i) const { return const_iterator(this, i == npos? npos: find_next(i+1)); }
+	/// @}
+};
+
+/// @cond
+template<class Word, class Alloc>
+const size_t bitmap<Word,Alloc>::npos;
+/// @endcond
+
+/// Iterates the elements of an XTL vector set or map in key order using the
+/// container's presence bitmap. Each step scans the bitmap for the next key
+/// and dereferencing looks the key up with Container::find().
+///
+/// @param Container	The container type, const qualified for constant iteration.
+/// @param Iter			The container iterator type returned by find().
+/// @remarks Models a forward iterator.
+template<class Container, class Iter>
+class bitmap_ordered_iterator: public std::iterator<std::forward_iterator_tag,
+					typename std::iterator_traits<Iter>::value_type,
+					std::ptrdiff_t,
+					typename std::iterator_traits<Iter>::pointer,
+					typename std::iterator_traits<Iter>::reference>
+{
+	/// @cond
+	Container*	_owner;
+	size_t		_pos;
+	/// @endcond
+public:
+	typedef typename std::iterator_traits<Iter>::reference	reference;
+	typedef typename std::iterator_traits<Iter>::pointer	pointer;
+
+	bitmap_ordered_iterator(): _owner(0), _pos(~size_t(0)) { }
+	bitmap_ordered_iterator(Container* owner, size_t pos): _owner(owner), _pos(pos) { }
+
+	/// The key at the current position.
+	size_t key() const { return _pos; }
+
+	reference operator * () const
+	{
+		return *_owner->find((typename Container::key_type)_pos);
+	}
+	pointer operator -> () const
+	{
+		return &**this;
+	}
+	bitmap_ordered_iterator& operator ++ ()
+	{
+		_pos = _owner->presence().find_next(_pos+1);
+		return *this;
+	}
+	bitmap_ordered_iterator operator ++ (int)
+	{
+		bitmap_ordered_iterator prev(*this);
+		++*this;
+		return prev;
+	}
+	bool operator == (const bitmap_ordered_iterator& other) const { return _pos == other._pos; }
+	bool operator != (const bitmap_ordered_iterator& other) const { return _pos != other._pos; }
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(BITMAP_0130B610_1DFE_4C99_99CD_C58E161FA0FC)
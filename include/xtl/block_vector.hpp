@@ -33,8 +33,10 @@
 
 #include <vector>
 #include <cassert>
+#include <utility>
 #include "property.hpp"
 #include "bitmagic.hpp"
+#include "memory.hpp"
 
 namespace xtl {
 // ----------------------------------------------------------------------------
@@ -469,6 +471,9 @@ private:
 	/// @cond
 	vector_type		_vecs;
 	allocator_type	_alloc;
+#if XTL_CONTAINER_STATS != 0
+	container_stats_counters	_stats;
+#endif
 
 	// Get the block before the end marker
 	node_type& back_node() { return _vecs[_vecs.size()-2]; }
@@ -476,17 +481,26 @@ private:
 	node_type& front_node() { return _vecs[1]; }
 	const node_type& front_node() const { return _vecs[1]; }
 
-	// Grow one element and copy construct with val
-	void grow(const_reference val)
+	// Make room for one element at the back and return its uninitialized storage.
+	// The caller constructs the element then increments back_node()._end.
+	T* grow_back()
 	{
 		// There are always two empty node_types to mark begin and end
 		if (_vecs.empty()) _vecs.resize(2);
 		if (back_node().size() == METRICS.BLOCK_SIZE || _vecs.size() == 2)
 		{
+			XTL_STATS_COUNT(grows);
 			_vecs.back()._begin = _vecs.back()._end = _alloc.allocate(METRICS.BLOCK_SIZE);
 			_vecs.resize(_vecs.size()+1);
 		}
-		_alloc.construct(back_node()._end++, val);
+		return back_node()._end;
+	}
+
+	// Grow one element and copy construct with val
+	void grow(const_reference val)
+	{
+		_alloc.construct(grow_back(), val);
+		++back_node()._end;
 	}
 
 	// Grow size elements and copy construct with val
@@ -499,6 +513,7 @@ private:
 		{
 			if (back_node().size() == METRICS.BLOCK_SIZE)
 			{
+				XTL_STATS_COUNT(grows);
 				_vecs.back()._begin = _vecs.back()._end = _alloc.allocate(METRICS.BLOCK_SIZE);
 				_vecs.resize(_vecs.size()+1);
 			}
@@ -548,6 +563,12 @@ private:
 	/// @endcond
 public:
 	block_vector(size_t size=0) { resize(size); }
+	/// Copy all elements from other.
+	block_vector(const block_vector& other)
+	{
+		for (const_iterator it=other.begin(); it != other.end(); ++it)
+			grow(*it);
+	}
 	~block_vector() { clear(); }
 
 	/// STL Random access operator
@@ -572,6 +593,42 @@ public:
 	/// STL container properties
 	size_t size() const { return (_vecs.size() <= 2)? 0: METRICS.BLOCK_SIZE*(_vecs.size()-3) + back_node().size(); }
 	bool empty() const { return _vecs.size() <= 2 || (_vecs.size() == 3 && back_node().size() == 0); }
+	/// @}
+
+	/// Get the hot path event counts. Only grows is maintained.
+	/// @see XTL_CONTAINER_STATS
+	container_stats stats() const
+	{
+#if XTL_CONTAINER_STATS != 0
+		return _stats.load();
+#else
+		return container_stats();
+#endif
+	}
+
+	/// Zero the hot path event counts.
+	void reset_stats()
+	{
+#if XTL_CONTAINER_STATS != 0
+		_stats.store(container_stats());
+#endif
+	}
+
+	/// Get the heap memory held by the vector. Slack is the unused part of the
+	/// last block, overhead is the block table.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info;
+		size_t blocks = (_vecs.size() <= 2)? 0: _vecs.size()-2;
+		info.payload = size()*sizeof(value_type);
+		info.slack = blocks*METRICS.BLOCK_SIZE*sizeof(value_type) - info.payload;
+		info.overhead = _vecs.capacity()*sizeof(node_type);
+		return info;
+	}
+
+	/// @{
+	/// STL container properties
 	reference front()
 	{
 		XTL_ITERATOR_ASSERT1(!empty());
@@ -597,6 +654,17 @@ public:
 	/// Append an item to the vector and copy construct
 	void push_back(const_reference x) { grow(x); }
 
+	/// Append an item to the vector and move construct
+	void push_back(value_type&& x) { emplace_back(std::move(x)); }
+
+	/// Append an item to the vector constructed in place from args
+	template<class... Args>
+	void emplace_back(Args&&... args)
+	{
+		_alloc.construct(grow_back(), std::forward<Args>(args)...);
+		++back_node()._end;
+	}
+
 	/// Append an item to the vector and default construct
 	void push_back() { grow(value_type()); }
 
@@ -631,6 +699,7 @@ public:
 	/// Copy all elements from other.
 	block_vector& operator = (const block_vector& other)
 	{
+		if (this == &other) return *this;
 		clear();
 		for (const_iterator it=other.begin(); it != other.end(); ++it)
 		{
@@ -0,0 +1,487 @@
+#ifndef INDEX_LIST_3C7D91E2_5A48_4F06_B1D3_8E2A64F0C957
+#define INDEX_LIST_3C7D91E2_5A48_4F06_B1D3_8E2A64F0C957
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Doubly linked lists which link by 32-bit index into shared block storage.
+/// @author Paul Glendenning
+/// @date
+
+#include <stdint.h>
+#include <iterator>
+#include <utility>
+#include "property.hpp"
+#include "block_vector.hpp"
+#include "memory.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// An index_list element. The links are indexes into the owning pool rather
+/// than pointers, so a node costs 8 bytes of link overhead instead of 16.
+template<class T>
+struct index_list_node
+{
+	uint32_t	_next;
+	uint32_t	_prev;
+	T			value;
+	index_list_node(): _next(0xFFFFFFFFU), _prev(0xFFFFFFFFU), value() { }
+	index_list_node(const T& v): _next(0xFFFFFFFFU), _prev(0xFFFFFFFFU), value(v) { }
+	index_list_node(T&& v): _next(0xFFFFFFFFU), _prev(0xFFFFFFFFU), value(std::move(v)) { }
+};
+
+/// Node storage shared by a set of index_list's. Nodes are kept in a
+/// block_vector so they never move and are addressed by a 32-bit index.
+/// Released nodes are kept on a free list threaded through the links and
+/// reused before the storage grows.
+///
+/// @param T		The element type. Must be default constructible and assignable.
+/// @param Alloc	Allocator function.
+/// @param BS		The storage block size.
+/// @remarks A pool holds at most 2^32-1 nodes.
+template<class T, class Alloc=std::allocator<T>, unsigned BS=1024>
+class index_list_pool
+{
+public:
+	typedef uint32_t					index_type;
+	typedef T							value_type;
+	typedef index_list_node<T>			node_type;
+	/// The null link.
+	static const index_type npos = 0xFFFFFFFFU;
+private:
+	/// @cond
+	typedef block_vector<node_type, typename Alloc::template rebind<node_type>::other, BS> storage_type;
+
+	storage_type	_nodes;
+	index_type		_free;
+	size_t			_live;
+
+	index_list_pool(const index_list_pool&);
+	index_list_pool& operator = (const index_list_pool&);
+
+	template<class V>
+	index_type acquire(V&& v)
+	{
+		++_live;
+		if (_free != npos)
+		{
+			index_type i = _free;
+			node_type& n = _nodes[i];
+			_free = n._next;
+			n._next = n._prev = npos;
+			n.value = std::forward<V>(v);
+			return i;
+		}
+		XTL_ITERATOR_ASSERT1(_nodes.size() < npos);
+		_nodes.emplace_back(std::forward<V>(v));
+		return index_type(_nodes.size()-1);
+	}
+	/// @endcond
+public:
+	index_list_pool(): _free(npos), _live(0) { }
+
+	/// Allocate an unlinked node and copy the value into it.
+	/// @return	The index of the node.
+	/// @remarks Complexity O(1).
+	index_type allocate(const T& v) { return acquire(v); }
+
+	/// Allocate an unlinked node and move the value into it.
+	/// @return	The index of the node.
+	/// @remarks Complexity O(1).
+	index_type allocate(T&& v) { return acquire(std::move(v)); }
+
+	/// Return an unlinked node to the free list. The value is reset so any
+	/// resources it holds are released now rather than on reuse.
+	/// @remarks Complexity O(1).
+	void release(index_type i)
+	{
+		XTL_ITERATOR_ASSERT1(_live > 0);
+		node_type& n = _nodes[i];
+		n.value = T();
+		n._prev = npos;
+		n._next = _free;
+		_free = i;
+		--_live;
+	}
+
+	/// @{
+	/// Access a node by index.
+	node_type& node(index_type i) { return _nodes[i]; }
+	const node_type& node(index_type i) const { return _nodes[i]; }
+	/// @}
+
+	/// @{
+	/// Access a value by index.
+	T& operator [] (index_type i) { return _nodes[i].value; }
+	const T& operator [] (index_type i) const { return _nodes[i].value; }
+	/// @}
+
+	/// Get the number of allocated nodes.
+	size_t size() const { return _live; }
+
+	/// Get the number of nodes allocated or free.
+	size_t capacity() const { return _nodes.size(); }
+
+	/// Reserve space for cap nodes in the block table.
+	void reserve(size_t cap) { _nodes.reserve(cap); }
+
+	/// Get the heap memory held by the pool. Free nodes count as slack.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _nodes.memory_usage();
+		size_t freeBytes = (_nodes.size() - _live)*sizeof(node_type);
+		info.payload -= freeBytes;
+		info.slack += freeBytes;
+		return info;
+	}
+};
+
+template<class T, class Alloc, unsigned BS>
+const typename index_list_pool<T,Alloc,BS>::index_type index_list_pool<T,Alloc,BS>::npos;
+
+template<class T, class Alloc, unsigned BS> class index_list;
+
+/// An index_list iterator.
+/// @param L	The index_list type.
+/// @param V	The value type, const qualified for a const iterator.
+template<class L, class V>
+class index_list_iterator: public std::iterator<std::bidirectional_iterator_tag, V>
+{
+public:
+	typedef typename L::index_type	index_type;
+private:
+	/// @cond
+	template<class L2, class V2> friend class index_list_iterator;
+	template<class T2, class A2, unsigned B2> friend class index_list;
+	const L*	_owner;
+	index_type	_index;
+	/// @endcond
+public:
+	index_list_iterator(): _owner(0), _index(L::npos) { }
+	index_list_iterator(const L* owner, index_type i): _owner(owner), _index(i) { }
+	/// Conversion from iterator to const_iterator.
+	template<class V2>
+	index_list_iterator(const index_list_iterator<L,V2>& other): _owner(other._owner), _index(other._index) { }
+
+	/// Get the pool index of the node, or npos at end.
+	index_type index() const { return _index; }
+
+	V& operator * () const
+	{
+		XTL_ITERATOR_ASSERT1(_index != L::npos);
+		return const_cast<V&>(_owner->pool()[_index]);
+	}
+	V* operator -> () const { return &**this; }
+
+	index_list_iterator& operator ++ ()
+	{
+		XTL_ITERATOR_ASSERT1(_index != L::npos);
+		_index = _owner->next(_index);
+		return *this;
+	}
+	index_list_iterator operator ++ (int)
+	{
+		index_list_iterator tmp(*this);
+		++*this;
+		return tmp;
+	}
+	/// Decrementing end() moves to the tail.
+	index_list_iterator& operator -- ()
+	{
+		_index = (_index == L::npos)? _owner->tail(): _owner->prev(_index);
+		XTL_ITERATOR_ASSERT1(_index != L::npos);
+		return *this;
+	}
+	index_list_iterator operator -- (int)
+	{
+		index_list_iterator tmp(*this);
+		--*this;
+		return tmp;
+	}
+
+	template<class V2>
+	bool operator == (const index_list_iterator<L,V2>& other) const { return _index == other._index; }
+	template<class V2>
+	bool operator != (const index_list_iterator<L,V2>& other) const { return _index != other._index; }
+};
+
+/// A doubly linked list whose nodes live in an index_list_pool shared with
+/// other lists. Links are 32-bit pool indexes, which halves the link overhead
+/// of intrusive_list on 64-bit targets and keeps the nodes of many small lists
+/// - adjacency lists for example - packed in a few large blocks instead of
+/// scattered over the heap.
+///
+/// Lists sharing a pool can splice nodes between each other in O(1). The list
+/// owns its nodes and releases them to the pool when cleared or destroyed, so
+/// the pool must outlive its lists.
+///
+/// @param T		The element type. Must be default constructible and assignable.
+/// @param Alloc	Allocator function.
+/// @param BS		The pool block size.
+template<class T, class Alloc=std::allocator<T>, unsigned BS=1024>
+class index_list
+{
+public:
+	typedef index_list_pool<T,Alloc,BS>			pool_type;
+	typedef typename pool_type::index_type		index_type;
+	typedef typename pool_type::node_type		node_type;
+	typedef T									value_type;
+	typedef T&									reference;
+	typedef const T&							const_reference;
+	typedef index_list_iterator<index_list, T>			iterator;
+	typedef index_list_iterator<index_list, const T>	const_iterator;
+	/// The null link.
+	static const index_type npos = pool_type::npos;
+private:
+	/// @cond
+	pool_type*	_pool;
+	index_type	_head;
+	index_type	_tail;
+	size_t		_size;
+
+	index_list(const index_list&);
+	index_list& operator = (const index_list&);
+
+	// Link the unlinked node i before pos, npos appends.
+	void link(index_type pos, index_type i)
+	{
+		node_type& n = _pool->node(i);
+		n._next = pos;
+		if (pos == npos)
+		{
+			n._prev = _tail;
+			_tail = i;
+		}
+		else
+		{
+			node_type& p = _pool->node(pos);
+			n._prev = p._prev;
+			p._prev = i;
+		}
+		if (n._prev == npos)
+			_head = i;
+		else
+			_pool->node(n._prev)._next = i;
+		++_size;
+	}
+
+	// Unlink node i and return the index of the next node.
+	index_type unlink(index_type i)
+	{
+		XTL_ITERATOR_ASSERT1(_size > 0);
+		node_type& n = _pool->node(i);
+		index_type next = n._next;
+		if (n._prev == npos)
+			_head = next;
+		else
+			_pool->node(n._prev)._next = next;
+		if (next == npos)
+			_tail = n._prev;
+		else
+			_pool->node(next)._prev = n._prev;
+		n._next = n._prev = npos;
+		--_size;
+		return next;
+	}
+	/// @endcond
+public:
+	explicit index_list(pool_type& pool): _pool(&pool), _head(npos), _tail(npos), _size(0) { }
+	/// Take ownership of the nodes in other, leaving other empty.
+	index_list(index_list&& other): _pool(other._pool), _head(other._head), _tail(other._tail), _size(other._size)
+	{
+		other._head = other._tail = npos;
+		other._size = 0;
+	}
+	/// Release all nodes to the pool.
+	~index_list() { clear(); }
+
+	/// Get the pool shared by this list.
+	/// @{
+	pool_type& pool() { return *_pool; }
+	const pool_type& pool() const { return *_pool; }
+	/// @}
+
+	/// @{
+	/// STL container properties
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	/// @}
+
+	/// @{
+	/// Node indexes at the ends of the list, npos if empty.
+	index_type head() const { return _head; }
+	index_type tail() const { return _tail; }
+	/// @}
+
+	/// @{
+	/// Navigate by node index. Returns npos past the ends.
+	index_type next(index_type i) const { return _pool->node(i)._next; }
+	index_type prev(index_type i) const { return _pool->node(i)._prev; }
+	/// @}
+
+	/// Convert a node index to an iterator.
+	/// @{
+	iterator cast_it(index_type i) { return iterator(this, i); }
+	const_iterator cast_it(index_type i) const { return const_iterator(this, i); }
+	/// @}
+
+	/// @{
+	/// STL container properties
+	reference front() { XTL_ITERATOR_ASSERT1(!empty()); return (*_pool)[_head]; }
+	const_reference front() const { XTL_ITERATOR_ASSERT1(!empty()); return (*_pool)[_head]; }
+	reference back() { XTL_ITERATOR_ASSERT1(!empty()); return (*_pool)[_tail]; }
+	const_reference back() const { XTL_ITERATOR_ASSERT1(!empty()); return (*_pool)[_tail]; }
+	/// @}
+
+	/// @{
+	/// STL iterators
+	iterator begin() { return iterator(this, _head); }
+	iterator end() { return iterator(this, npos); }
+	const_iterator begin() const { return const_iterator(this, _head); }
+	const_iterator end() const { return const_iterator(this, npos); }
+	/// @}
+
+	/// Append a copy of v.
+	/// @return	The pool index of the new node.
+	/// @remarks Complexity O(1).
+	index_type push_back(const T& v)
+	{
+		index_type i = _pool->allocate(v);
+		link(npos, i);
+		return i;
+	}
+
+	/// Append v by move.
+	/// @return	The pool index of the new node.
+	/// @remarks Complexity O(1).
+	index_type push_back(T&& v)
+	{
+		index_type i = _pool->allocate(std::move(v));
+		link(npos, i);
+		return i;
+	}
+
+	/// Prepend a copy of v.
+	/// @return	The pool index of the new node.
+	/// @remarks Complexity O(1).
+	index_type push_front(const T& v)
+	{
+		index_type i = _pool->allocate(v);
+		link(_head, i);
+		return i;
+	}
+
+	/// Insert a copy of v before pos.
+	/// @return	An iterator to the new element.
+	/// @remarks Complexity O(1).
+	iterator insert(const_iterator pos, const T& v)
+	{
+		XTL_ITERATOR_ASSERT1(pos._owner == this);
+		index_type i = _pool->allocate(v);
+		link(pos._index, i);
+		return iterator(this, i);
+	}
+
+	/// Erase the element at pos and release its node to the pool.
+	/// @return	An iterator to the element following pos.
+	/// @remarks Complexity O(1).
+	iterator erase(const_iterator pos)
+	{
+		XTL_ITERATOR_ASSERT1(pos._owner == this && pos._index != npos);
+		index_type next = unlink(pos._index);
+		_pool->release(pos._index);
+		return iterator(this, next);
+	}
+
+	/// @{
+	/// Remove an element from an end of the list.
+	void pop_front() { XTL_ITERATOR_ASSERT1(!empty()); erase(begin()); }
+	void pop_back() { XTL_ITERATOR_ASSERT1(!empty()); erase(cast_it(_tail)); }
+	/// @}
+
+	/// Erase all elements and release their nodes to the pool.
+	/// @remarks Complexity O(N).
+	void clear()
+	{
+		for (index_type i = _head; i != npos; )
+		{
+			index_type next = _pool->node(i)._next;
+			_pool->release(i);
+			i = next;
+		}
+		_head = _tail = npos;
+		_size = 0;
+	}
+
+	/// Move the node at pos from other to before pos in this list. No node
+	/// is allocated and the element keeps its pool index.
+	/// @remarks Complexity O(1).
+	void splice(const_iterator pos, index_list& other, const_iterator it)
+	{
+		XTL_ITERATOR_ASSERT1(_pool == other._pool && pos._owner == this && it._owner == &other);
+		XTL_ITERATOR_ASSERT1(it._index != npos && it._index != pos._index);
+		other.unlink(it._index);
+		link(pos._index, it._index);
+	}
+
+	/// Append all elements of other to this list, leaving other empty.
+	/// @remarks Complexity O(1).
+	void splice(index_list& other)
+	{
+		XTL_ITERATOR_ASSERT1(_pool == other._pool);
+		if (&other == this || other.empty()) return;
+		if (_tail == npos)
+			_head = other._head;
+		else
+		{
+			_pool->node(_tail)._next = other._head;
+			_pool->node(other._head)._prev = _tail;
+		}
+		_tail = other._tail;
+		_size += other._size;
+		other._head = other._tail = npos;
+		other._size = 0;
+	}
+
+	/// Exchange contents with other. Both lists must share a pool.
+	void swap(index_list& other)
+	{
+		XTL_ITERATOR_ASSERT1(_pool == other._pool);
+		std::swap(_head, other._head);
+		std::swap(_tail, other._tail);
+		std::swap(_size, other._size);
+	}
+};
+
+template<class T, class Alloc, unsigned BS>
+const typename index_list<T,Alloc,BS>::index_type index_list<T,Alloc,BS>::npos;
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(INDEX_LIST_3C7D91E2_5A48_4F06_B1D3_8E2A64F0C957)
@@ -0,0 +1,396 @@
+#ifndef INTRUSIVE_HASH_SET_9C2D4B71_E05A_4F3E_8B16_7A4F0D25C8E3
+#define INTRUSIVE_HASH_SET_9C2D4B71_E05A_4F3E_8B16_7A4F0D25C8E3
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	An intrusive hash set with incremental rehashing.
+/// @author Paul Glendenning
+/// @date
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <string>
+#include <utility>
+#include "property.hpp"
+#include "bitmagic.hpp"
+#include "memory.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// The default intrusive_hash_set hash function. Integer keys use the
+/// bitmagic FNV hash.
+template<class Key>
+struct bitmagic_hash
+{
+	size_t operator () (Key key) const { return bitmagic<Key>::FNV_hash(key); }
+};
+
+/// FNV-1a hash of the string bytes.
+template<>
+struct bitmagic_hash<std::string>
+{
+	size_t operator () (const std::string& key) const
+	{
+		uint64_t hash = bitmagic<uint64_t>::_fnv_offset;
+		for (size_t i=0; i<key.size(); ++i)
+		{
+			hash ^= uint64_t((unsigned char)key[i]);
+			hash *= bitmagic<uint64_t>::_fnv_prime;
+		}
+		return size_t(hash);
+	}
+};
+
+/// Intrusive node base class for intrusive_hash_set. Items derive from this
+/// class. The node caches the hash of the item's key.
+class intrusive_hash_node
+{
+	template<class T, class KeyOf, class Hash, class Equal, class Alloc> friend class intrusive_hash_set;
+protected:
+	/// @cond
+	intrusive_hash_node*	_hnext;
+	size_t					_hash;
+	/// @endcond
+public:
+	intrusive_hash_node(): _hnext(0), _hash(0) { }
+
+	/// Can't copy node links.
+	intrusive_hash_node(const intrusive_hash_node&): _hnext(0), _hash(0) { }
+
+	/// Can't assign node links.
+	intrusive_hash_node& operator = (const intrusive_hash_node&) { return *this; }
+};
+
+/// A hash set of items which embed their own links, so insert and erase never
+/// allocate. Buckets are singly linked chains through intrusive_hash_node.
+///
+/// The table doubles when the size exceeds the bucket count. Rather than moving
+/// every item at once, the old table is kept and REHASH_STEP old buckets are
+/// moved to the new table by each insert() and erase() until it is empty.
+/// Lookups check whichever table currently holds the key's bucket. The cost of
+/// a doubling is therefore one allocation of the new bucket array and a few
+/// bucket moves per operation, rather than one O(size()) pause. New buckets
+/// are initialized as they are filled by the migration, so even the bucket
+/// array is not cleared up front.
+///
+/// @code
+/// struct connection: public intrusive_hash_node { std::string peer; ... };
+/// struct peer_of { typedef std::string key_type; const std::string& operator () (const connection& c) const { return c.peer; } };
+/// intrusive_hash_set<connection, peer_of> table;
+/// table.insert(c);
+/// connection* p = table.find("10.0.0.1:443");
+/// @endcode
+///
+/// @param T		The item type. Must derive from intrusive_hash_node.
+/// @param KeyOf	Functor returning the key of an item. Must define key_type.
+/// @param Hash		Hash functor for the key.
+/// @param Equal	Equality functor for the key.
+/// @param Alloc	Allocator for the bucket arrays.
+/// @remarks The time complexity for insert, erase, and find is O(1) average.
+/// The space complexity is O(size()) for the bucket arrays only.
+template<class T, class KeyOf, class Hash=bitmagic_hash<typename KeyOf::key_type>,
+	class Equal=std::equal_to<typename KeyOf::key_type>, class Alloc=std::allocator<T*> >
+class intrusive_hash_set
+{
+public:
+	typedef T							value_type;
+	typedef typename KeyOf::key_type	key_type;
+	typedef KeyOf						key_of;
+	typedef Hash						hasher;
+	typedef Equal						key_equal;
+	enum {
+		/// Old buckets moved per insert() and erase() while rehashing.
+		REHASH_STEP = 4,
+		/// The initial bucket count.
+		MIN_BUCKETS = 16
+	};
+private:
+	/// @cond
+	typedef intrusive_hash_node node_type;
+	typedef typename Alloc::template rebind<node_type*>::other bucket_allocator;
+	// KeyOf may return the key by value or by reference
+	typedef typename std::result_of<const KeyOf(const T&)>::type key_result;
+
+	// The current table. While rehashing it is the new table and its buckets
+	// are only initialized for migrated old buckets.
+	node_type**		_buckets;
+	size_t			_mask;
+	// The table being migrated, null when not rehashing.
+	node_type**		_old;
+	size_t			_oldMask;
+	// Old buckets below this index have been migrated.
+	size_t			_migrated;
+	size_t			_size;
+	KeyOf			_keyOf;
+	Hash			_hash;
+	Equal			_equal;
+	bucket_allocator _allocator;
+
+	intrusive_hash_set(const intrusive_hash_set&);
+	intrusive_hash_set& operator = (const intrusive_hash_set&);
+
+	// Mix the high bits down since the table is indexed by the low bits.
+	static size_t mix(size_t h)
+	{
+		h ^= h >> (sizeof(size_t)*4);
+		return h ^ (h >> 13);
+	}
+
+	key_result key(const node_type* n) const { return _keyOf(*static_cast<const T*>(n)); }
+
+	// Get the bucket which currently holds hash h.
+	node_type** bucket(size_t h) const
+	{
+		if (_old && (h & _oldMask) >= _migrated)
+			return _old + (h & _oldMask);
+		return _buckets + (h & _mask);
+	}
+
+	node_type* find_node(const key_type& k, size_t h) const
+	{
+		for (node_type* n=*bucket(h); n; n=n->_hnext)
+		{
+			if (n->_hash == h && _equal(key(n), k))
+				return n;
+		}
+		return 0;
+	}
+
+	void allocate(size_t buckets)
+	{
+		_buckets = _allocator.allocate(buckets);
+		_mask = buckets - 1;
+	}
+
+	// Start doubling the table.
+	void grow()
+	{
+		XTL_ITERATOR_ASSERT1(!_old);
+		_old = _buckets;
+		_oldMask = _mask;
+		_migrated = 0;
+		allocate((_mask+1) << 1);
+	}
+
+	// Move up to count old buckets to the new table.
+	void migrate(size_t count)
+	{
+		size_t oldSize = _oldMask + 1;
+		for (size_t end=std::min(_migrated + count, oldSize); _migrated<end; ++_migrated)
+		{
+			// Old bucket i splits into new buckets i and i+oldSize
+			node_type** lo = _buckets + _migrated;
+			node_type** hi = lo + oldSize;
+			*lo = *hi = 0;
+			for (node_type* n=_old[_migrated], *next; n; n=next)
+			{
+				next = n->_hnext;
+				node_type** b = (n->_hash & oldSize)? hi: lo;
+				n->_hnext = *b;
+				*b = n;
+			}
+		}
+		if (_migrated == oldSize)
+		{
+			_allocator.deallocate(_old, oldSize);
+			_old = 0;
+		}
+	}
+
+	void step()
+	{
+		if (_old)
+			migrate(REHASH_STEP);
+		else if (_size > _mask)
+			grow();
+	}
+	/// @endcond
+
+public:
+	/// Create a set.
+	/// @param buckets	The initial bucket count, rounded up to a power of 2.
+	explicit intrusive_hash_set(size_t buckets=MIN_BUCKETS, const Hash& hash=Hash(), const Equal& equal=Equal()):
+		_old(0), _oldMask(0), _migrated(0), _size(0), _hash(hash), _equal(equal)
+	{
+		buckets = bitmagic<size_t>::nextpow2(std::max(buckets, (size_t)MIN_BUCKETS));
+		allocate(buckets);
+		std::fill(_buckets, _buckets + buckets, (node_type*)0);
+	}
+
+	/// Items are not touched, they are owned by the caller.
+	~intrusive_hash_set()
+	{
+		if (_old) _allocator.deallocate(_old, _oldMask+1);
+		_allocator.deallocate(_buckets, _mask+1);
+	}
+
+	/// Get the number of items.
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+	/// Get the bucket count of the current table.
+	size_t bucket_count() const { return _mask + 1; }
+
+	/// True while old buckets are being moved to a new table.
+	bool rehashing() const { return _old != 0; }
+
+	/// Finish any rehash in progress and grow the table so that n items fit
+	/// without further rehashing.
+	/// @remarks Complexity O(size() + n).
+	void reserve(size_t n)
+	{
+		while (_old || _mask + 1 < n)
+		{
+			if (!_old) grow();
+			migrate(_oldMask + 1);
+		}
+	}
+
+	/// Insert an item. The item must not be in a set.
+	/// @return	The item with an equal key and false if one exists, otherwise
+	///			item and true.
+	/// @remarks Complexity O(1) average.
+	std::pair<T*, bool> insert(T* item)
+	{
+		step();
+		key_result k = _keyOf(*item);
+		size_t h = mix(_hash(k));
+		node_type* n = find_node(k, h);
+		if (n)
+			return std::make_pair(static_cast<T*>(n), false);
+		n = static_cast<node_type*>(item);
+		node_type** b = bucket(h);
+		n->_hash = h;
+		n->_hnext = *b;
+		*b = n;
+		++_size;
+		return std::make_pair(item, true);
+	}
+
+	/// Find the item with key k.
+	/// @return	The item or null.
+	/// @remarks Complexity O(1) average.
+	T* find(const key_type& k) const
+	{
+		return static_cast<T*>(find_node(k, mix(_hash(k))));
+	}
+
+	/// Check if an item with key k exists.
+	bool test(const key_type& k) const { return find(k) != 0; }
+
+	/// Remove the item with key k.
+	/// @return	The removed item or null.
+	/// @remarks Complexity O(1) average.
+	T* erase(const key_type& k)
+	{
+		if (_old) migrate(REHASH_STEP);
+		size_t h = mix(_hash(k));
+		for (node_type** p=bucket(h); *p; p=&(*p)->_hnext)
+		{
+			node_type* n = *p;
+			if (n->_hash == h && _equal(key(n), k))
+			{
+				*p = n->_hnext;
+				n->_hnext = 0;
+				--_size;
+				return static_cast<T*>(n);
+			}
+		}
+		return 0;
+	}
+
+	/// Remove an item.
+	/// @return	False if item is not in the set.
+	/// @remarks Complexity O(1) average.
+	bool erase(T* item)
+	{
+		if (_old) migrate(REHASH_STEP);
+		node_type* target = static_cast<node_type*>(item);
+		for (node_type** p=bucket(target->_hash); *p; p=&(*p)->_hnext)
+		{
+			if (*p == target)
+			{
+				*p = target->_hnext;
+				target->_hnext = 0;
+				--_size;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Remove all items. The bucket arrays are kept.
+	/// @remarks Complexity O(bucket_count()).
+	void clear()
+	{
+		if (_old)
+		{
+			_allocator.deallocate(_old, _oldMask+1);
+			_old = 0;
+		}
+		std::fill(_buckets, _buckets + _mask + 1, (node_type*)0);
+		_size = 0;
+	}
+
+	/// Call f(T&) for each item in unspecified order. f must not insert or
+	/// erase items.
+	/// @remarks Complexity O(size() + bucket_count()).
+	template<class F>
+	void for_each(F f) const
+	{
+		if (_old)
+		{
+			for (size_t i=_migrated; i<=_oldMask; ++i)
+				for (node_type* n=_old[i]; n; n=n->_hnext)
+					f(*static_cast<T*>(n));
+		}
+		for (size_t i=0; i<=_mask; ++i)
+		{
+			// Unmigrated buckets of the new table are uninitialized
+			if (_old && (i & _oldMask) >= _migrated)
+				continue;
+			for (node_type* n=_buckets[i]; n; n=n->_hnext)
+				f(*static_cast<T*>(n));
+		}
+	}
+
+	/// Get the heap memory held by the set. Only the bucket arrays are owned.
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info;
+		info.index = (_mask + 1 + (_old? _oldMask + 1: 0))*sizeof(node_type*);
+		return info;
+	}
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(INTRUSIVE_HASH_SET_9C2D4B71_E05A_4F3E_8B16_7A4F0D25C8E3)
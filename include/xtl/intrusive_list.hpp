@@ -33,7 +33,10 @@
 // Author Paul Glendenning
 
 #include <cassert>
+#include <cstddef>
 #include <algorithm>
+#include <functional>
+#include <type_traits>
 #include "property.hpp"
 
 namespace xtl {
@@ -46,6 +49,8 @@ template<class T> class intrusive_list_item<const T*>;
 template<class T> class intrusive_list_unlinkable_item;
 template<class T> class intrusive_list_iterator;
 template<class T> class const_intrusive_list_iterator;
+class intrusive_list_hook;
+template<class T, intrusive_list_hook T::*Member, size_t Offset> class member_hook;
 
 
 /// Traits for intrusive list items
@@ -68,6 +73,14 @@ struct intrusive_list_traits
 	/// @}
 
 	static bool supports_sizeof() { return item_type::supports_sizeof(); }
+
+	/// @{
+	/// Get the value of a list item.
+	static pointer pointer_cast(item_type* p) { return p->pointer_cast(); }
+	static const value_type* pointer_cast(const item_type* p) { return p->pointer_cast(); }
+	static reference reference_cast(item_type* p) { return p->reference_cast(); }
+	static const value_type& reference_cast(const item_type* p) { return p->reference_cast(); }
+	/// @}
 };
 
 /// Intrusive node base class. All list items need to include this somewhere
@@ -486,6 +499,118 @@ private:
 	static bool supports_sizeof() { return false; }
 };
 
+/// A list node for use as a data member. A class may declare several hooks
+/// and be on one list per hook at the same time. Select the hook with
+/// member_hook<>.
+class intrusive_list_hook: public intrusive_list_node
+{
+public:
+	/// @{
+	/// C style list traversal. Use member_hook<>::pointer_cast() to get the
+	/// object.
+	intrusive_list_hook* next() const { return static_cast<intrusive_list_hook*>(_next); }
+	intrusive_list_hook* prev() const { return static_cast<intrusive_list_hook*>(_prev); }
+	/// @}
+};
+
+/// The member_hook<> type for the intrusive_list_hook data member of T.
+#define	XTL_MEMBER_HOOK(T, member)	xtl::member_hook<T, &T::member, offsetof(T, member)>
+
+/// List item selector for objects linked through an intrusive_list_hook data
+/// member. Each hook member gives a distinct list type. The list holds the
+/// hooks themselves, its item_type is intrusive_list_hook.
+///
+/// @code
+/// struct order
+/// {
+///     intrusive_list_hook lru_hook;
+///     intrusive_list_hook tenant_hook;
+///     ...
+/// };
+/// typedef XTL_MEMBER_HOOK(order, lru_hook) lru_item;
+/// intrusive_list<order, lru_item> lru;
+/// intrusive_list<order, XTL_MEMBER_HOOK(order, tenant_hook)> tenant;
+/// lru.push_back(lru_item::item_of(&o));
+/// order* p = lru_item::pointer_cast(lru.head());
+/// @endcode
+///
+/// Offset is the compile time offsetof() of the hook, so converting a hook to
+/// its object is a constant adjustment. T must be a standard layout type.
+/// Spell the type with XTL_MEMBER_HOOK() so Member and Offset agree.
+///
+/// @param T		The object type.
+/// @param Member	The hook data member of T.
+/// @param Offset	The offset of Member within T.
+template<class T, intrusive_list_hook T::*Member, size_t Offset>
+class member_hook
+{
+	static_assert(std::is_standard_layout<T>::value, "member_hook requires a standard layout type");
+private:
+	/// @cond
+	member_hook();
+	/// @endcond
+public:
+	/// The object the hook is a member of
+	typedef	T value_type;
+	/// A pointer to the object
+	typedef T* pointer;
+	/// A reference to the object
+	typedef T& reference;
+
+	/// Get the hook of an object.
+	static intrusive_list_hook* item_of(T* p)
+	{
+		XTL_ITERATOR_ASSERT1(pointer_cast(&(p->*Member)) == p);
+		return &(p->*Member);
+	}
+
+	/// @{
+	/// Get the object of a hook.
+	static T* pointer_cast(intrusive_list_hook* p)
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<char*>(p) - Offset);
+	}
+	static const T* pointer_cast(const intrusive_list_hook* p)
+	{
+		return reinterpret_cast<const T*>(reinterpret_cast<const char*>(p) - Offset);
+	}
+	static T& reference_cast(intrusive_list_hook* p) { return *pointer_cast(p); }
+	static const T& reference_cast(const intrusive_list_hook* p) { return *pointer_cast(p); }
+	/// @}
+};
+
+/// Traits for lists of intrusive_list_hook members. The list holds the hooks
+/// and member_hook<> converts them to objects.
+template<class T, intrusive_list_hook T::*Member, size_t Offset>
+struct intrusive_list_traits<member_hook<T, Member, Offset> >
+{
+	typedef member_hook<T, Member, Offset>	hook_type;
+	typedef intrusive_list_hook		item_type;
+	typedef	intrusive_list<T, hook_type>	list_type;
+
+	/// STL iterator definitions
+	typedef intrusive_list_iterator<list_type>			iterator;
+	typedef const_intrusive_list_iterator<list_type>	const_iterator;
+	typedef std::reverse_iterator<iterator>				reverse_iterator;
+	typedef std::reverse_iterator<const_iterator>		const_reverse_iterator;
+	/// @} @{
+	/// STL typedefs for value access
+	typedef T	value_type;
+	typedef T*	pointer;
+	typedef T&	reference;
+	/// @}
+
+	static bool supports_sizeof() { return true; }
+
+	/// @{
+	/// Get the object of a hook.
+	static T* pointer_cast(item_type* p) { return hook_type::pointer_cast(p); }
+	static const T* pointer_cast(const item_type* p) { return hook_type::pointer_cast(p); }
+	static T& reference_cast(item_type* p) { return hook_type::reference_cast(p); }
+	static const T& reference_cast(const item_type* p) { return hook_type::reference_cast(p); }
+	/// @}
+};
+
 // Bidirectional iterator pattern
 /// @cond
 template<class List>
@@ -553,19 +678,20 @@ class const_intrusive_list_iterator: public intrusive_list_iterator_base<List>,
 {
 	/// @cond
     template<class T, class ListItem> friend class intrusive_list;
+	template<class L> friend class intrusive_list_iterator;
 	typedef intrusive_list_iterator_base<List>	super;
 public:
 	typedef const typename List::item_type* ite_pointer;
 	// STL iterator patterns
-	typename List::reference operator * () const
+	const typename List::value_type& operator * () const
 	{
-		XTL_ITERATOR_ASSERT1(super::_owner.last() != super::_node);
-		return static_cast<ite_pointer>(super::_node)->reference_cast();
+		XTL_ITERATOR_ASSERT1(super::_owner->last() != super::_node);
+		return List::traits_type::reference_cast(static_cast<ite_pointer>(super::_node));
 	}
-	typename List::pointer operator -> () const
+	const typename List::value_type* operator -> () const
 	{
-		XTL_ITERATOR_ASSERT1(super::_owner.last() != super::_node);
-		return static_cast<ite_pointer>(super::_node)->pointer_cast();
+		XTL_ITERATOR_ASSERT1(super::_owner->last() != super::_node);
+		return List::traits_type::pointer_cast(static_cast<ite_pointer>(super::_node));
 	}
 
 	const_intrusive_list_iterator& operator ++ ()
@@ -617,12 +743,12 @@ public:
 	typename List::reference operator * () const 
 	{
 		XTL_ITERATOR_ASSERT1(super::_owner->last() != super::_node);
-		return static_cast<ite_pointer>(super::_node)->reference_cast();
+		return List::traits_type::reference_cast(static_cast<ite_pointer>(super::_node));
 	}
 	typename List::pointer operator-> () const
 	{
 		XTL_ITERATOR_ASSERT1(super::_owner->last() != super::_node);
-		return static_cast<ite_pointer>(super::_node)->pointer_cast();
+		return List::traits_type::pointer_cast(static_cast<ite_pointer>(super::_node));
 	}
 #if XTL_ITERATOR_CHECKS != 0
 	operator const_intrusive_list_iterator<List> () const { return const_intrusive_list_iterator<List>(super::_node, super::_owner); }
@@ -695,7 +821,7 @@ public:
 
 	/// Items stored in this list. Memory allocation of item_type is outside the
 	/// scope of this class.
-	typedef	ListItem	item_type;
+	typedef	typename traits_type::item_type	item_type;
 private:
 	/// List head and tail. Also serves as an end marker.
 	intrusive_list_node		_end;
@@ -705,10 +831,104 @@ private:
 #if XTL_ITERATOR_CHECKS > 1
 	void reset_owner(intrusive_list* newOwner)
 	{
-		for (item_type* p = _end._next; p != &_end; p=p->next())
+		for (intrusive_list_node* p = _end._next; p != &_end; p=p->_next)
 			p->_owner = newOwner;
 	}
 #endif
+
+	template<class Compare>
+	struct node_compare
+	{
+		Compare comp;
+		node_compare(Compare c): comp(c) { }
+		bool operator () (const intrusive_list_node* a, const intrusive_list_node* b) const
+		{
+			return comp(traits_type::reference_cast(static_cast<const item_type*>(a)), traits_type::reference_cast(static_cast<const item_type*>(b)));
+		}
+	};
+
+	// Merge two null terminated chains linked by _next only. Stable, on equal
+	// elements a comes first.
+	template<class NodeCompare>
+	static intrusive_list_node* merge_chains(intrusive_list_node* a, intrusive_list_node* b, NodeCompare& comp)
+	{
+		intrusive_list_node head;
+		intrusive_list_node* tail = &head;
+		while (a && b)
+		{
+			if (comp(b, a))
+			{
+				tail->_next = b;
+				b = b->_next;
+			}
+			else
+			{
+				tail->_next = a;
+				a = a->_next;
+			}
+			tail = tail->_next;
+		}
+		tail->_next = a? a: b;
+		return head._next;
+	}
+
+	static size_t range_length(const intrusive_list_node* first, const intrusive_list_node* last)
+	{
+		size_t n = 0;
+		for (; first != last; first = first->_next)
+			++n;
+		return n;
+	}
+
+	// Move [first,last) of other before pos, n is the length of the range.
+	void move_range(intrusive_list_node* pos, intrusive_list& other, intrusive_list_node* first, intrusive_list_node* last, size_t n)
+	{
+		if (first == last || pos == last)
+			return;
+	#if XTL_ITERATOR_CHECKS > 1
+		for (intrusive_list_node* p = first; p != last; p = p->_next)
+			p->_owner = this;
+	#endif
+		intrusive_list_node* back = last->_prev;
+		// Close the gap in other
+		first->_prev->_next = last;
+		last->_prev = first->_prev;
+		// Link in before pos
+		first->_prev = pos->_prev;
+		pos->_prev->_next = first;
+		back->_next = pos;
+		pos->_prev = back;
+		if (&other != this)
+		{
+			_size += n;
+			other._size -= n;
+		}
+	}
+
+	// Detach the elements as a null terminated chain. The list is left empty.
+	intrusive_list_node* detach_chain()
+	{
+		if (_end._next == &_end)
+			return 0;
+		intrusive_list_node* first = _end._next;
+		_end._prev->_next = 0;
+		_end._next = _end._prev = &_end;
+		return first;
+	}
+
+	// Make a null terminated chain the list contents, restoring _prev links.
+	void attach_chain(intrusive_list_node* first)
+	{
+		intrusive_list_node* prev = &_end;
+		for (intrusive_list_node* p = first; p; p = p->_next)
+		{
+			p->_prev = prev;
+			prev->_next = p;
+			prev = p;
+		}
+		prev->_next = &_end;
+		_end._prev = prev;
+	}
 public:
 	intrusive_list() 
 	{
@@ -773,29 +993,129 @@ public:
 	/// Join two lists by appending other to this list The join clears the other
 	/// list.
 	/// @param	other	The list to append.
+	/// @remarks Complexity O(1).
 	void splice(intrusive_list& other)
 	{
-		if (!other.empty())
+		move_range(&_end, other, other._end._next, &other._end, other._size);
+	}
+
+	/// Move all elements of other before pos. The other list is cleared.
+	/// @remarks Complexity O(1).
+	void splice(iterator pos, intrusive_list& other)
+	{
+		XTL_ITERATOR_ASSERT1(pos._owner == this);
+		move_range(pos._node, other, other._end._next, &other._end, other._size);
+	}
+
+	/// Move the range [first,last) of other before pos. Other may be this list
+	/// provided pos is not in the range.
+	/// @param	n	The length of the range. Must be exact for sized lists unless
+	///				other is this list.
+	/// @remarks Complexity O(1).
+	void splice(iterator pos, intrusive_list& other, iterator first, iterator last, size_t n)
+	{
+		XTL_ITERATOR_ASSERT1(pos._owner == this);
+		XTL_ITERATOR_ASSERT1(first._owner == &other && last._owner == &other);
+		XTL_ITERATOR_ASSERT2(!traits_type::supports_sizeof() || &other == this || n == range_length(first._node, last._node));
+		move_range(pos._node, other, first._node, last._node, n);
+	}
+
+	/// Move the range [first,last) of other before pos. Other may be this list
+	/// provided pos is not in the range.
+	/// @remarks Complexity O(1) for lists of unlinkable items, otherwise
+	/// O(|last-first|) to count the range. Supply the length to avoid the count.
+	void splice(iterator pos, intrusive_list& other, iterator first, iterator last)
+	{
+		size_t n = (traits_type::supports_sizeof() && &other != this)? range_length(first._node, last._node): 0;
+		splice(pos, other, first, last, n);
+	}
+
+	/// Split the list at an element. Elements [at,end()) are appended to tail.
+	/// @param	n	The number of elements in [at,end()). Must be exact for sized lists.
+	/// @remarks Complexity O(1).
+	void split(iterator at, intrusive_list& tail, size_t n)
+	{
+		XTL_ITERATOR_ASSERT1(at._owner == this && &tail != this);
+		tail.move_range(&tail._end, *this, at._node, &_end, n);
+	}
+
+	/// Split the list at an element. Elements [at,end()) are appended to tail.
+	/// @remarks Complexity O(1) for lists of unlinkable items, otherwise
+	/// O(|end()-at|) to count the range. Supply the length to avoid the count.
+	void split(iterator at, intrusive_list& tail)
+	{
+		split(at, tail, traits_type::supports_sizeof()? range_length(at._node, &_end): 0);
+	}
+
+	/// Sort the list in place. The sort is a stable bottom up merge sort, as
+	/// used by std::list<>::sort(), which relinks nodes and never allocates.
+	/// @param	comp	Strict weak ordering of value_type.
+	/// @remarks Complexity O(N log N) compares. Iterators and item pointers
+	/// remain valid.
+	template<class Compare>
+	void sort(Compare comp)
+	{
+		if (_end._next == _end._prev)
+			return;
+		node_compare<Compare> ncomp(comp);
+		// bins[i] is null or a sorted run of 2^i nodes, older than bins[j<i]
+		intrusive_list_node* bins[sizeof(size_t)*8];
+		size_t fill = 0;
+		intrusive_list_node* p = detach_chain();
+		while (p)
 		{
-		#if XTL_ITERATOR_CHECKS > 1
-			other.reset_owner(this);
-		#endif
-			other._end._next->_prev = &_end;
-			other._end._prev->_next = _end._next;
-			_end._next->_prev = other._end._prev;
-			_end._next = other._end._next;
-			other._end.unlink();
-			_size + other._size;
-			other._size = 0;
+			intrusive_list_node* carry = p;
+			p = p->_next;
+			carry->_next = 0;
+			size_t i = 0;
+			for (; i < fill && bins[i]; ++i)
+			{
+				carry = merge_chains(bins[i], carry, ncomp);
+				bins[i] = 0;
+			}
+			bins[i] = carry;
+			if (i == fill) ++fill;
 		}
+		intrusive_list_node* result = 0;
+		for (size_t i = 0; i < fill; ++i)
+		{
+			if (bins[i]) result = merge_chains(bins[i], result, ncomp);
+		}
+		attach_chain(result);
 	}
 
+	/// Sort the list in place using value_type::operator <.
+	void sort() { sort(std::less<value_type>()); }
+
+	/// Merge the sorted list other into this sorted list. The merge is stable,
+	/// equal elements of this list come first. The other list is cleared.
+	/// @param	comp	The ordering both lists are sorted by.
+	/// @remarks Complexity O(N+M) compares.
+	template<class Compare>
+	void merge(intrusive_list& other, Compare comp)
+	{
+		if (&other == this || other.empty())
+			return;
+	#if XTL_ITERATOR_CHECKS > 1
+		other.reset_owner(this);
+	#endif
+		node_compare<Compare> ncomp(comp);
+		intrusive_list_node* a = detach_chain();
+		attach_chain(merge_chains(a, other.detach_chain(), ncomp));
+		_size += other._size;
+		other._size = 0;
+	}
+
+	/// Merge using value_type::operator <.
+	void merge(intrusive_list& other) { merge(other, std::less<value_type>()); }
+
 	/// @{
 	/// C style list access to list item types.
 	/// - To iterate the pointer range [head,last), traverse the list using item_type::next(). 
 	/// - To iterate the reverse pointer range [tail, last), traverse the list using
 	///   item_type::prev().
-	/// - To access list elements use item_type::pointer_cast() or item_type::reference_cast().
+	/// - To access list elements use item_type::pointer_cast() or item_type::reference_cast(),
+	///   or member_hook<>::pointer_cast() for lists of hooks.
 	/// - to remove list elements use item_type::unlink().
 	item_type* head() { return static_cast<item_type*>(_end._next); }
 	item_type* tail() { return static_cast<item_type*>(_end._prev); }
@@ -808,20 +1128,20 @@ public:
 	/// @{
 	/// STL patterns
     bool empty() const { return _end._prev == _end._next && _end._next == &_end; }
-    reference front() { assert(!empty()); return head()->reference_cast(); }
-    reference front() const { assert(!empty()); return head()->reference_cast(); }
-    reference back() { assert(!empty()); return tail()->reference_cast(); }
-    reference back() const { assert(!empty()); return tail()->reference_cast(); }
+    reference front() { assert(!empty()); return traits_type::reference_cast(head()); }
+    reference front() const { assert(!empty()); return traits_type::reference_cast(head()); }
+    reference back() { assert(!empty()); return traits_type::reference_cast(tail()); }
+    reference back() const { assert(!empty()); return traits_type::reference_cast(tail()); }
 #if XTL_ITERATOR_CHECKS != 0
     iterator begin() { return iterator(_end._next, this); }
     iterator end() { return iterator(&_end, this); }
     const_iterator begin() const { return const_iterator(_end._next, this); }
-    const_iterator end() const { return const_iterator(&_end, this); }
+    const_iterator end() const { return const_iterator(const_cast<intrusive_list_node*>(&_end), this); }
 #else
     iterator begin() { return iterator(_end._next); }
     iterator end() { return iterator(&_end); }
     const_iterator begin() const { return const_iterator(_end._next); }
-    const_iterator end() const { return const_iterator(&_end); }
+    const_iterator end() const { return const_iterator(const_cast<intrusive_list_node*>(&_end)); }
 #endif
     reverse_iterator rbegin() { return reverse_iterator(end()); }
     reverse_iterator rend() { return reverse_iterator(begin()); }
@@ -0,0 +1,264 @@
+#ifndef LOCKFREE_4E81C7A2_3D5B_4F09_9A6E_C2B8D017F354
+#define LOCKFREE_4E81C7A2_3D5B_4F09_9A6E_C2B8D017F354
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Lock free intrusive queue and stack.
+/// @author Paul Glendenning
+/// @date
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include "property.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// Intrusive node base class for the lock free containers. As with
+/// intrusive_list_node, objects derive from this class and the containers link
+/// them without allocating. A node may be in at most one container at a time.
+class lockfree_node
+{
+	template<class T> friend class mpsc_queue;
+	template<class T> friend class treiber_stack;
+protected:
+	/// @cond
+	std::atomic<lockfree_node*>	_next;
+	/// @endcond
+public:
+	lockfree_node(): _next(0) { }
+
+	/// Can't copy node links.
+	lockfree_node(const lockfree_node&): _next(0) { }
+
+	/// Can't assign node links.
+	lockfree_node& operator = (const lockfree_node&) { return *this; }
+};
+
+/// An unbounded intrusive multiple producer single consumer queue. This is
+/// Dmitry Vyukov's algorithm: producers exchange the head and then link the
+/// previous head to the new node, the consumer follows the links from the tail.
+///
+/// push() is wait free, one atomic exchange and one store. pop() is lock free
+/// for the consumer but returns null while a producer is between its exchange
+/// and its store, even though the queue is not empty. Consumers which must not
+/// miss items should retry or wait on their own event.
+///
+/// @code
+/// struct message: public lockfree_node { ... };
+/// mpsc_queue<message> q;
+/// q.push(m);					// any thread
+/// while ((m = q.pop()) != 0)	// the consumer thread
+///     handle(m);
+/// @endcode
+///
+/// @param T	The item type. Must derive from lockfree_node.
+template<class T>
+class mpsc_queue
+{
+private:
+	/// @cond
+	enum { CACHE_LINE = 64 };
+	// Producers write _head, the consumer owns _tail, keep them apart.
+	std::atomic<lockfree_node*>	_head;
+	char						_pad[CACHE_LINE];
+	lockfree_node*				_tail;
+	lockfree_node				_stub;
+
+	mpsc_queue(const mpsc_queue&);
+	mpsc_queue& operator = (const mpsc_queue&);
+
+	void link(lockfree_node* n)
+	{
+		n->_next.store(0, std::memory_order_relaxed);
+		lockfree_node* prev = _head.exchange(n, std::memory_order_acq_rel);
+		prev->_next.store(n, std::memory_order_release);
+	}
+	/// @endcond
+
+public:
+	typedef T	value_type;
+
+	mpsc_queue(): _head(&_stub), _tail(&_stub) { }
+
+	/// Add an item at the head. Safe from any thread.
+	/// @remarks Complexity O(1), wait free.
+	void push(T* item) { link(static_cast<lockfree_node*>(item)); }
+
+	/// Remove the item at the tail. Only one thread may pop.
+	/// @return	The item or null if the queue is empty or a push is in progress.
+	/// @remarks Complexity O(1).
+	T* pop()
+	{
+		lockfree_node* tail = _tail;
+		lockfree_node* next = tail->_next.load(std::memory_order_acquire);
+		if (tail == &_stub)
+		{
+			if (!next)
+				return 0;
+			_tail = tail = next;
+			next = next->_next.load(std::memory_order_acquire);
+		}
+		if (next)
+		{
+			_tail = next;
+			return static_cast<T*>(tail);
+		}
+		if (tail != _head.load(std::memory_order_acquire))
+			return 0;
+		// tail is the last item, put the stub behind it so it can be unlinked
+		link(&_stub);
+		next = tail->_next.load(std::memory_order_acquire);
+		if (next)
+		{
+			_tail = next;
+			return static_cast<T*>(tail);
+		}
+		return 0;
+	}
+
+	/// Check if the queue is empty. Only meaningful on the consumer thread.
+	bool empty() const
+	{
+		return _tail == &_stub && !_stub._next.load(std::memory_order_acquire)
+			&& _head.load(std::memory_order_acquire) == &_stub;
+	}
+};
+
+/// An intrusive lock free LIFO stack, R. K. Treiber's algorithm. Any thread may
+/// push and pop.
+///
+/// The top is a tagged pointer, the node address plus a counter incremented by
+/// every change, updated with one compare and swap. The counter guards against
+/// the ABA problem where a node is popped and pushed again between another
+/// thread reading the top and its compare and swap. The tag is held in the
+/// upper 16 bits of a 64 bit address, or in the upper 32 bits of a 64 bit word
+/// on 32 bit targets.
+///
+/// @warning On 64 bit targets every node address must fit in the low 48 bits,
+/// as user space addresses do on current x86-64 and AArch64 systems. Five
+/// level paging, pointer tagging, or other address space layouts which set the
+/// upper bits are not supported. push() checks each node and throws rather
+/// than corrupt the stack.
+///
+/// Nodes may be reused immediately after pop() but their memory must remain
+/// valid while other threads may still be using the stack, since a thread
+/// which lost a race may read the next link of a popped node.
+///
+/// @param T	The item type. Must derive from lockfree_node.
+template<class T>
+class treiber_stack
+{
+private:
+	/// @cond
+	enum {
+		TAG_SHIFT = (sizeof(void*) == 8)? 48: 32
+	};
+	static const uint64_t POINTER_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+
+	std::atomic<uint64_t>	_top;
+
+	treiber_stack(const treiber_stack&);
+	treiber_stack& operator = (const treiber_stack&);
+
+	static lockfree_node* pointer_of(uint64_t top) { return reinterpret_cast<lockfree_node*>(uintptr_t(top & POINTER_MASK)); }
+	static bool fits(const lockfree_node* n) { return (uint64_t(uintptr_t(n)) & ~POINTER_MASK) == 0; }
+	static uint64_t make_top(lockfree_node* n, uint64_t prev)
+	{
+		XTL_ITERATOR_ASSERT1(fits(n));
+		return ((prev + (uint64_t(1) << TAG_SHIFT)) & ~POINTER_MASK) | uint64_t(uintptr_t(n));
+	}
+	/// @endcond
+
+public:
+	typedef T	value_type;
+
+	treiber_stack(): _top(0) { }
+
+	/// Add an item at the top.
+	/// @throw	std::invalid_argument if the item address uses the tag bits.
+	/// The stack is unchanged.
+	/// @remarks Complexity O(1), lock free.
+	void push(T* item)
+	{
+		lockfree_node* n = static_cast<lockfree_node*>(item);
+		if (!fits(n))
+			throw std::invalid_argument("treiber_stack: node address uses the tag bits");
+		uint64_t top = _top.load(std::memory_order_relaxed);
+		do
+			n->_next.store(pointer_of(top), std::memory_order_relaxed);
+		while (!_top.compare_exchange_weak(top, make_top(n, top), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	/// Remove the item at the top.
+	/// @return	The item or null if the stack is empty.
+	/// @remarks Complexity O(1), lock free.
+	T* pop()
+	{
+		// A thread which read top, stalled, and resumes after exactly a multiple
+		// of 2^16 changes on 64 bit targets sees the same tag. If the node is
+		// back on top by then its compare and swap succeeds with a stale next,
+		// so the tag makes ABA unlikely rather than impossible.
+		uint64_t top = _top.load(std::memory_order_acquire);
+		lockfree_node* n;
+		do
+		{
+			n = pointer_of(top);
+			if (!n)
+				return 0;
+		}
+		while (!_top.compare_exchange_weak(top, make_top(n->_next.load(std::memory_order_relaxed), top),
+			std::memory_order_acquire, std::memory_order_acquire));
+		return static_cast<T*>(n);
+	}
+
+	/// Remove all items.
+	/// @return	The former top item. Follow the items with next().
+	T* pop_all()
+	{
+		uint64_t top = _top.load(std::memory_order_acquire);
+		while (pointer_of(top) && !_top.compare_exchange_weak(top, make_top(0, top),
+			std::memory_order_acquire, std::memory_order_acquire))
+			;
+		return static_cast<T*>(pointer_of(top));
+	}
+
+	/// Get the item below item. For use on the list returned by pop_all().
+	static T* next(T* item)
+	{
+		return static_cast<T*>(static_cast<lockfree_node*>(item)->_next.load(std::memory_order_relaxed));
+	}
+
+	/// Check if the stack is empty. The result may be stale.
+	bool empty() const { return pointer_of(_top.load(std::memory_order_acquire)) == 0; }
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(LOCKFREE_4E81C7A2_3D5B_4F09_9A6E_C2B8D017F354)
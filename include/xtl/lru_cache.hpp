@@ -0,0 +1,299 @@
+#ifndef LRU_CACHE_6A0E2F54_91C3_4D7B_A8E6_0B4F73C9D215
+#define LRU_CACHE_6A0E2F54_91C3_4D7B_A8E6_0B4F73C9D215
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	A least recently used cache with an integer key.
+/// @author Paul Glendenning
+/// @date
+
+#include <utility>
+#include "property.hpp"
+#include "block_vector.hpp"
+#include "intrusive_list.hpp"
+#include "unordered_vector_map.hpp"
+#include "memory.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// An lru_cache element.
+template<class Key, class T>
+struct lru_cache_entry
+{
+	Key		key;
+	T		value;
+	/// The cost charged against the cache capacity.
+	size_t	cost;
+	lru_cache_entry(): key(), value(), cost(0) { }
+};
+
+/// A least recently used cache. Entries are kept in recency order on an
+/// intrusive_list and located by an unordered_vector_map index, so get, put,
+/// and eviction are O(1).
+///
+/// Entries are stored in a block_vector and never move, so a pointer returned by
+/// get() or put() is valid until the entry is evicted or erased. Evicted slots
+/// are kept on a free list and reused, so once the cache has filled and the key
+/// domain has been reserved, put() does not allocate.
+///
+/// Each entry has a cost, one by default. The cache evicts least recently used
+/// entries until the total cost is no more than the capacity.
+///
+/// @param Key		The key type. Must be an integer type.
+/// @param T		The cached type. Must be default constructible and assignable.
+/// @param Alloc	Allocator function.
+/// @param BS		The storage block size.
+/// @remarks The space complexity is O(N+K), where N is the maximum number of
+/// entries and K is the maximum key.
+template<class Key, class T, class Alloc=std::allocator<T>, unsigned BS=1024>
+class lru_cache
+{
+public:
+	typedef Key						key_type;
+	typedef T						mapped_type;
+	typedef lru_cache_entry<Key,T>	value_type;
+	typedef intrusive_list<value_type>	list_type;
+	typedef typename list_type::item_type	item_type;
+	typedef typename list_type::const_iterator	const_iterator;
+private:
+	/// @cond
+	typedef block_vector<item_type, typename Alloc::template rebind<item_type>::other, BS> storage_type;
+	typedef unordered_vector_map<Key, item_type*,
+		typename Alloc::template rebind<std::pair<Key,item_type*> >::other> index_type;
+
+	storage_type	_items;
+	index_type		_index;
+	// Most recently used at the head
+	list_type		_lru;
+	// Slots of _items which are not in use
+	list_type		_free;
+	size_t			_capacity;
+	size_t			_cost;
+	size_t			_hits;
+	size_t			_misses;
+
+	lru_cache(const lru_cache&);
+	lru_cache& operator = (const lru_cache&);
+
+	void touch(item_type* item)
+	{
+		if (item != _lru.head())
+		{
+			_lru.erase(_lru.cast_it(item));
+			_lru.push_front(item);
+		}
+	}
+
+	item_type* acquire()
+	{
+		if (!_free.empty())
+		{
+			item_type* item = _free.head();
+			_free.pop_front();
+			return item;
+		}
+		_items.push_back(item_type());
+		return &_items.back();
+	}
+
+	void release(item_type* item)
+	{
+		value_type& v = item->reference_cast();
+		_cost -= v.cost;
+		_index.erase(v.key);
+		_lru.erase(_lru.cast_it(item));
+		// Release any resources held by the value now rather than on reuse
+		v.value = T();
+		v.cost = 0;
+		_free.push_front(item);
+	}
+
+	// Evict from the least recently used end until the cost fits
+	void trim()
+	{
+		while (_cost > _capacity)
+			release(_lru.tail());
+	}
+
+	template<class V>
+	T* assign(key_type key, V&& value, size_t cost)
+	{
+		typename index_type::iterator i = _index.find(key);
+		// Rejected up front so an oversized value evicts nothing but the
+		// entry it replaces
+		if (cost > _capacity)
+		{
+			if (i != _index.end())
+				release(i->second);
+			return 0;
+		}
+		item_type* item;
+		if (i != _index.end())
+		{
+			item = i->second;
+			touch(item);
+			_cost -= item->reference_cast().cost;
+		}
+		else
+		{
+			item = acquire();
+			_lru.push_front(item);
+			_index.insert(std::make_pair(key, item));
+			item->reference_cast().key = key;
+		}
+		value_type& v = item->reference_cast();
+		v.value = std::forward<V>(value);
+		v.cost = cost;
+		_cost += cost;
+		// The new entry is at the head and fits on its own so is never evicted
+		trim();
+		return &v.value;
+	}
+	/// @endcond
+
+public:
+	/// Create a cache.
+	/// @param	capacity	The maximum total cost of the entries.
+	/// @param	domain		Reserve the index for keys in [0,domain).
+	lru_cache(size_t capacity, size_t domain=0):
+		_index(domain), _capacity(capacity), _cost(0), _hits(0), _misses(0) { }
+
+	/// Get the maximum total cost.
+	size_t capacity() const { return _capacity; }
+
+	/// Change the maximum total cost. Evicts entries if required.
+	void set_capacity(size_t capacity)
+	{
+		_capacity = capacity;
+		trim();
+	}
+
+	/// Get the total cost of the entries.
+	size_t cost() const { return _cost; }
+
+	/// Get the number of entries.
+	size_t size() const { return _index.size(); }
+	bool empty() const { return _index.empty(); }
+
+	/// Reserve the index for keys in [0,domain).
+	void reserve(size_t domain) { _index.reserve(domain); }
+
+	/// Look up a key and make it the most recently used entry.
+	/// @return	The cached value or null if key is not cached.
+	/// @remarks Complexity O(1).
+	T* get(key_type key)
+	{
+		typename index_type::iterator i = _index.find(key);
+		if (i == _index.end())
+		{
+			++_misses;
+			return 0;
+		}
+		++_hits;
+		touch(i->second);
+		return &i->second->reference_cast().value;
+	}
+
+	/// Look up a key without changing the recency order or the counters.
+	/// @return	The cached value or null if key is not cached.
+	/// @remarks Complexity O(1).
+	const T* peek(key_type key) const
+	{
+		typename index_type::const_iterator i = _index.find(key);
+		return (i == _index.end())? 0: &i->second->reference_cast().value;
+	}
+
+	/// Insert or replace a value and make it the most recently used entry. Least
+	/// recently used entries are evicted until the total cost fits.
+	/// @return	The cached value, or null if cost alone exceeds the capacity in
+	///			which case the value is not cached, any previous value of key
+	///			is removed, and no other entry is evicted.
+	/// @remarks Complexity O(1) plus O(1) per evicted entry.
+	T* put(key_type key, const T& value, size_t cost=1) { return assign(key, value, cost); }
+	T* put(key_type key, T&& value, size_t cost=1) { return assign(key, std::move(value), cost); }
+
+	/// Remove a key.
+	/// @return	True if the key was cached.
+	/// @remarks Complexity O(1).
+	bool erase(key_type key)
+	{
+		typename index_type::iterator i = _index.find(key);
+		if (i == _index.end())
+			return false;
+		release(i->second);
+		return true;
+	}
+
+	/// Evict the least recently used entry.
+	/// @return	False if the cache is empty.
+	/// @remarks Complexity O(1).
+	bool evict()
+	{
+		if (_lru.empty())
+			return false;
+		release(_lru.tail());
+		return true;
+	}
+
+	/// Evict all entries. Storage is kept for reuse.
+	/// @remarks Complexity O(size()).
+	void clear()
+	{
+		while (!_lru.empty())
+			release(_lru.tail());
+	}
+
+	/// @{
+	/// Hit and miss counters maintained by get().
+	size_t hits() const { return _hits; }
+	size_t misses() const { return _misses; }
+	void reset_counters() { _hits = _misses = 0; }
+	/// @}
+
+	/// @{
+	/// Iterate entries from most to least recently used.
+	const_iterator begin() const { return _lru.begin(); }
+	const_iterator end() const { return _lru.end(); }
+	/// @}
+
+	/// Get the heap memory held by the cache. Free slots are counted as slack
+	/// and all of the key index as index.
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _items.memory_usage();
+		info.payload = size()*sizeof(item_type);
+		info.slack += (_items.size() - size())*sizeof(item_type);
+		info.index = _index.memory_usage().total();
+		return info;
+	}
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(LRU_CACHE_6A0E2F54_91C3_4D7B_A8E6_0B4F73C9D215)
@@ -0,0 +1,153 @@
+#ifndef MEMORY_3B9D6E21_7F4C_4A85_B0D3_C58E1A27F946
+#define MEMORY_3B9D6E21_7F4C_4A85_B0D3_C58E1A27F946
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Memory accounting for xtl containers.
+/// @author Paul Glendenning
+/// @date
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <typeinfo>
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// A breakdown of the heap memory held by a container, in bytes. Returned by
+/// the memory_usage() member of each container. Per allocation headers added
+/// by the heap itself are not visible to the container and are not included.
+struct memory_usage_info
+{
+	/// Live elements, size()*sizeof(value_type).
+	size_t	payload;
+	/// Sparse indexes and bitmaps used to locate elements.
+	size_t	index;
+	/// Element storage which is allocated but not in use.
+	size_t	slack;
+	/// Bookkeeping such as block tables, page directories and free lists.
+	size_t	overhead;
+
+	memory_usage_info(): payload(0), index(0), slack(0), overhead(0) { }
+
+	/// Get the total bytes.
+	size_t total() const { return payload + index + slack + overhead; }
+
+	memory_usage_info& operator += (const memory_usage_info& other)
+	{
+		payload += other.payload;
+		index += other.index;
+		slack += other.slack;
+		overhead += other.overhead;
+		return *this;
+	}
+};
+
+/// Called by counting_allocator after each allocation and deallocation.
+/// @param	tag		The counting_allocator Tag type.
+/// @param	delta	The change in bytes, negative for a deallocation.
+typedef void (*memory_hook_type)(const std::type_info& tag, std::ptrdiff_t delta);
+
+/// Get the global memory hook. Null by default. Set it before containers using
+/// counting_allocator are created and do not change it while they are in use.
+inline memory_hook_type& memory_hook()
+{
+	static memory_hook_type hook = 0;
+	return hook;
+}
+
+/// Live byte count for all counting_allocator instances with the given Tag.
+template<class Tag>
+struct memory_counter
+{
+	static std::atomic<std::ptrdiff_t>& bytes()
+	{
+		static std::atomic<std::ptrdiff_t> count(0);
+		return count;
+	}
+};
+
+/// An allocator which counts the bytes it has outstanding per Tag and reports
+/// changes to memory_hook(). All xtl containers rebind their allocator for
+/// internal storage, so passing a counting_allocator as the Alloc parameter
+/// accounts for the index and bookkeeping as well as the elements.
+///
+/// @code
+/// struct routes_tag { };
+/// unordered_vector_map<unsigned, route, counting_allocator<std::pair<unsigned,route>, routes_tag> > routes;
+/// ...
+/// size_t bytes = memory_counter<routes_tag>::bytes();
+/// @endcode
+///
+/// @param T	The allocated type.
+/// @param Tag	Selects the counter. Containers of different types can share a tag.
+template<class T, class Tag=void>
+class counting_allocator: public std::allocator<T>
+{
+	typedef std::allocator<T> _super;
+public:
+	typedef typename _super::pointer	pointer;
+	typedef typename _super::size_type	size_type;
+
+	template<class U> struct rebind { typedef counting_allocator<U, Tag> other; };
+
+	counting_allocator() { }
+	counting_allocator(const counting_allocator& other): _super(other) { }
+	template<class U> counting_allocator(const counting_allocator<U, Tag>&) { }
+
+	pointer allocate(size_type n, const void* hint=0)
+	{
+		pointer p = _super::allocate(n, hint);
+		count(std::ptrdiff_t(n*sizeof(T)));
+		return p;
+	}
+
+	void deallocate(pointer p, size_type n)
+	{
+		count(-std::ptrdiff_t(n*sizeof(T)));
+		_super::deallocate(p, n);
+	}
+
+private:
+	static void count(std::ptrdiff_t delta)
+	{
+		memory_counter<Tag>::bytes() += delta;
+		if (memory_hook())
+			memory_hook()(typeid(Tag), delta);
+	}
+};
+
+template<class T, class U, class Tag>
+inline bool operator == (const counting_allocator<T,Tag>&, const counting_allocator<U,Tag>&) { return true; }
+template<class T, class U, class Tag>
+inline bool operator != (const counting_allocator<T,Tag>&, const counting_allocator<U,Tag>&) { return false; }
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(MEMORY_3B9D6E21_7F4C_4A85_B0D3_C58E1A27F946)
@@ -0,0 +1,305 @@
+#ifndef OBJECT_POOL_8B2E4F17_C6A9_4D35_9E01_7F3B5A2C68D4
+#define OBJECT_POOL_8B2E4F17_C6A9_4D35_9E01_7F3B5A2C68D4
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	An object pool which allocates from block_vector storage.
+/// @author Paul Glendenning
+/// @date
+
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "property.hpp"
+#include "block_vector.hpp"
+#include "memory.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+template<class Pool> class object_pool_cache;
+
+/// An object_pool storage slot. While free, the slot is linked on a free list
+/// through _next. While live, _next points at the slot itself.
+template<class T>
+struct object_pool_slot
+{
+	typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _storage;
+	object_pool_slot*	_next;
+	object_pool_slot(): _next(0) { }
+
+	bool live() const { return _next == this; }
+	T* pointer_cast() { return reinterpret_cast<T*>(&_storage); }
+	const T* pointer_cast() const { return reinterpret_cast<const T*>(&_storage); }
+	static object_pool_slot* slot_cast(T* p) { return reinterpret_cast<object_pool_slot*>(p); }
+};
+
+/// A fixed size object allocator for intrusive list items and similar
+/// objects. Slots are drawn from block_vector blocks, so objects never move
+/// and there is no heap allocation per object. Freed slots are recycled
+/// through a free list embedded in the slots.
+///
+/// The pool itself is not synchronized. For multithreaded use give each
+/// thread an object_pool_cache, which allocates and frees locally and
+/// exchanges slots with the pool in batches under the pool lock. Once caches
+/// are in use all threads must go through a cache.
+///
+/// @param T		The object type.
+/// @param BS		The storage block size.
+/// @param Alloc	Allocator function.
+template<class T, unsigned BS=1024, class Alloc=std::allocator<T> >
+class object_pool
+{
+public:
+	typedef T						value_type;
+	typedef object_pool_slot<T>		slot_type;
+private:
+	/// @cond
+	template<class Pool> friend class object_pool_cache;
+	typedef block_vector<slot_type, typename Alloc::template rebind<slot_type>::other, BS> storage_type;
+
+	storage_type	_slots;
+	slot_type*		_free;
+	// Slots not on the free list, including those held by caches
+	size_t			_live;
+	std::mutex		_lock;
+
+	object_pool(const object_pool&);
+	object_pool& operator = (const object_pool&);
+
+	slot_type* acquire()
+	{
+		slot_type* s = _free;
+		if (s != 0)
+			_free = s->_next;
+		else
+		{
+			_slots.emplace_back();
+			s = &_slots.back();
+		}
+		++_live;
+		return s;
+	}
+
+	// Take up to n slots for a cache, growing the storage if necessary.
+	slot_type* refill(size_t n)
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		slot_type* head = 0;
+		for (; n != 0; --n)
+		{
+			slot_type* s = acquire();
+			s->_next = head;
+			head = s;
+		}
+		return head;
+	}
+
+	// Return a chain of n free slots from a cache.
+	void drain(slot_type* head, slot_type* tail, size_t n)
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		tail->_next = _free;
+		_free = head;
+		_live -= n;
+	}
+	/// @endcond
+public:
+	object_pool(): _free(0), _live(0) { }
+	/// Destroy all live objects. Caches must be destroyed first.
+	~object_pool()
+	{
+		for (typename storage_type::iterator it = _slots.begin(); it != _slots.end(); ++it)
+		{
+			if (it->live())
+				it->pointer_cast()->~T();
+		}
+	}
+
+	/// Construct an object in a free slot.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	T* allocate(Args&&... args)
+	{
+		slot_type* s = acquire();
+		try
+		{
+			::new (static_cast<void*>(s->pointer_cast())) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			s->_next = _free;
+			_free = s;
+			--_live;
+			throw;
+		}
+		s->_next = s;
+		return s->pointer_cast();
+	}
+
+	/// Destroy an object and return its slot to the free list.
+	/// @remarks Complexity O(1).
+	void free(T* p)
+	{
+		slot_type* s = slot_type::slot_cast(p);
+		XTL_ITERATOR_ASSERT1(s->live() && _live > 0);
+		p->~T();
+		s->_next = _free;
+		_free = s;
+		--_live;
+	}
+
+	/// Call f(T&) for each live object in storage order.
+	/// @remarks Complexity O(capacity()).
+	template<class F>
+	void for_each_live(F f)
+	{
+		for (typename storage_type::iterator it = _slots.begin(); it != _slots.end(); ++it)
+		{
+			if (it->live())
+				f(*it->pointer_cast());
+		}
+	}
+
+	/// Get the number of slots in use, including slots held by caches.
+	size_t size() const { return _live; }
+
+	/// Get the number of slots in use or free.
+	size_t capacity() const { return _slots.size(); }
+
+	/// Add free slots until the capacity is at least n, so subsequent
+	/// allocations do not touch the heap.
+	void reserve(size_t n)
+	{
+		_slots.reserve(n);
+		while (_slots.size() < n)
+		{
+			_slots.emplace_back();
+			slot_type* s = &_slots.back();
+			s->_next = _free;
+			_free = s;
+		}
+	}
+
+	/// Get the heap memory held by the pool. Free slots count as slack.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _slots.memory_usage();
+		size_t freeBytes = (_slots.size() - _live)*sizeof(slot_type);
+		info.payload -= freeBytes;
+		info.slack += freeBytes;
+		return info;
+	}
+};
+
+/// A per thread front end for an object_pool. Allocations and frees are
+/// served from a local free list, which is refilled from and drained to the
+/// pool in batches so the pool lock is taken once per batch.
+///
+/// An object may be freed through a different cache than allocated it.
+/// @param Pool	The object_pool type.
+template<class Pool>
+class object_pool_cache
+{
+public:
+	typedef typename Pool::value_type	value_type;
+	typedef typename Pool::slot_type	slot_type;
+private:
+	/// @cond
+	Pool&		_pool;
+	slot_type*	_free;
+	size_t		_count;
+	size_t		_batch;
+
+	object_pool_cache(const object_pool_cache&);
+	object_pool_cache& operator = (const object_pool_cache&);
+
+	// Return all but keep slots to the pool.
+	void drain(size_t keep)
+	{
+		if (_count <= keep) return;
+		size_t n = _count - keep;
+		slot_type* head = _free;
+		slot_type* tail = head;
+		for (size_t i = 1; i < n; ++i)
+			tail = tail->_next;
+		_free = tail->_next;
+		_count = keep;
+		_pool.drain(head, tail, n);
+	}
+	/// @endcond
+public:
+	/// @param pool		The shared pool.
+	/// @param batch	The number of slots exchanged with the pool at a time.
+	explicit object_pool_cache(Pool& pool, size_t batch=64): _pool(pool), _free(0), _count(0), _batch(batch? batch: 1) { }
+	/// Return all cached slots to the pool.
+	~object_pool_cache() { flush(); }
+
+	/// Construct an object in a free slot.
+	/// @remarks Complexity amortized O(1).
+	template<class... Args>
+	value_type* allocate(Args&&... args)
+	{
+		if (_free == 0)
+		{
+			_free = _pool.refill(_batch);
+			_count = _batch;
+		}
+		slot_type* s = _free;
+		::new (static_cast<void*>(s->pointer_cast())) value_type(std::forward<Args>(args)...);
+		_free = s->_next;
+		--_count;
+		s->_next = s;
+		return s->pointer_cast();
+	}
+
+	/// Destroy an object and keep its slot in the cache.
+	/// @remarks Complexity amortized O(1).
+	void free(value_type* p)
+	{
+		slot_type* s = slot_type::slot_cast(p);
+		XTL_ITERATOR_ASSERT1(s->live());
+		p->~value_type();
+		s->_next = _free;
+		_free = s;
+		if (++_count >= 2*_batch)
+			drain(_batch);
+	}
+
+	/// Get the number of free slots held by the cache.
+	size_t size() const { return _count; }
+
+	/// Return all cached slots to the pool.
+	void flush() { drain(0); }
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(OBJECT_POOL_8B2E4F17_C6A9_4D35_9E01_7F3B5A2C68D4)
@@ -0,0 +1,278 @@
+#ifndef PAIRING_HEAP_E41A6C93_2D7F_4B58_A0C6_59F83B1D27E4
+#define PAIRING_HEAP_E41A6C93_2D7F_4B58_A0C6_59F83B1D27E4
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	An intrusive pairing heap.
+/// @author Paul Glendenning
+/// @date
+
+#include <functional>
+#include <utility>
+#include "property.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+template<class T, class Compare> class pairing_heap;
+
+/// Base class for pairing_heap elements. The heap links are embedded in the
+/// element so the heap never allocates.
+class pairing_heap_node
+{
+	template<class T, class Compare> friend class pairing_heap;
+protected:
+	/// @cond
+	pairing_heap_node*	_child;
+	pairing_heap_node*	_next;
+	// The left sibling, or the parent for a first child. Null for the root
+	// and this for an unlinked node.
+	pairing_heap_node*	_prev;
+
+	void reset() { _child = _next = 0; _prev = this; }
+	/// @endcond
+public:
+	/// An unlinked node points to itself
+	pairing_heap_node() { reset(); }
+
+	/// Can't copy heap links.
+	pairing_heap_node(const pairing_heap_node&) { reset(); }
+
+	/// Can't assign heap links. The target keeps its own links.
+	pairing_heap_node& operator = (const pairing_heap_node&) { return *this; }
+
+	/// True if in a heap
+	bool is_linked() const { return _prev != this; }
+};
+
+/// An intrusive min-heap. Elements derive from pairing_heap_node and are owned
+/// by the caller, so a pointer to an element is also its handle for erase()
+/// and decrease().
+///
+/// Unlike std::priority_queue, top() is the least element under Compare, which
+/// suits deadline queues ordered by std::less.
+///
+/// @param T		The element type. Must derive from pairing_heap_node.
+/// @param Compare	Strict weak ordering of T.
+/// @remarks Complexity push(), decrease(), merge() and top() are O(1).
+/// pop() and erase() are O(log N) amortized.
+template<class T, class Compare=std::less<T> >
+class pairing_heap
+{
+public:
+	typedef T			value_type;
+	typedef Compare		value_compare;
+private:
+	/// @cond
+	typedef pairing_heap_node node_type;
+
+	node_type*	_root;
+	size_t		_size;
+	Compare		_comp;
+
+	pairing_heap(const pairing_heap&);
+	pairing_heap& operator = (const pairing_heap&);
+
+	static T* cast(node_type* n) { return static_cast<T*>(n); }
+
+	// Link two roots, the greater becoming the first child of the lesser.
+	node_type* meld(node_type* a, node_type* b)
+	{
+		if (_comp(*cast(b), *cast(a)))
+			std::swap(a, b);
+		b->_prev = a;
+		b->_next = a->_child;
+		if (a->_child != 0)
+			a->_child->_prev = b;
+		a->_child = b;
+		return a;
+	}
+
+	// Two pass pairing of a sibling list into a single root. The first pass
+	// melds pairs left to right, stacking the results through _next. The
+	// second melds the stack into one tree.
+	node_type* merge_pairs(node_type* first)
+	{
+		node_type* stack = 0;
+		while (first != 0)
+		{
+			node_type* a = first;
+			node_type* b = a->_next;
+			a->_prev = 0;
+			if (b == 0)
+			{
+				a->_next = stack;
+				stack = a;
+				break;
+			}
+			first = b->_next;
+			a->_next = b->_next = 0;
+			b->_prev = 0;
+			a = meld(a, b);
+			a->_next = stack;
+			stack = a;
+		}
+		if (stack == 0) return 0;
+		node_type* root = stack;
+		stack = stack->_next;
+		root->_next = 0;
+		while (stack != 0)
+		{
+			node_type* n = stack;
+			stack = stack->_next;
+			n->_next = 0;
+			root = meld(root, n);
+		}
+		return root;
+	}
+
+	// Detach a non root subtree from its parent.
+	static void cut(node_type* n)
+	{
+		if (n->_prev->_child == n)
+			n->_prev->_child = n->_next;
+		else
+			n->_prev->_next = n->_next;
+		if (n->_next != 0)
+			n->_next->_prev = n->_prev;
+		n->_next = n->_prev = 0;
+	}
+	/// @endcond
+public:
+	explicit pairing_heap(const Compare& comp=Compare()): _root(0), _size(0), _comp(comp) { }
+	/// Unlink all elements.
+	~pairing_heap() { clear(); }
+
+	/// @{
+	/// STL container properties
+	size_t size() const { return _size; }
+	bool empty() const { return _root == 0; }
+	/// @}
+
+	/// Get the least element.
+	/// @{
+	T& top() { XTL_ITERATOR_ASSERT1(!empty()); return *cast(_root); }
+	const T& top() const { XTL_ITERATOR_ASSERT1(!empty()); return *cast(_root); }
+	/// @}
+
+	/// Insert an unlinked element.
+	/// @remarks Complexity O(1).
+	void push(T* p)
+	{
+		node_type* n = p;
+		XTL_ITERATOR_ASSERT1(!n->is_linked());
+		n->_child = n->_next = n->_prev = 0;
+		_root = (_root == 0)? n: meld(_root, n);
+		++_size;
+	}
+
+	/// Remove the least element.
+	/// @remarks Complexity O(log N) amortized.
+	void pop()
+	{
+		XTL_ITERATOR_ASSERT1(!empty());
+		erase(cast(_root));
+	}
+
+	/// Remove any element in the heap.
+	/// @remarks Complexity O(log N) amortized.
+	void erase(T* p)
+	{
+		node_type* n = p;
+		XTL_ITERATOR_ASSERT1(n->is_linked() && _size > 0);
+		if (n == _root)
+			_root = merge_pairs(n->_child);
+		else
+		{
+			cut(n);
+			node_type* sub = merge_pairs(n->_child);
+			if (sub != 0)
+				_root = meld(_root, sub);
+		}
+		n->reset();
+		--_size;
+	}
+
+	/// Restore the heap order after the key of p has decreased.
+	/// @remarks Complexity O(1).
+	void decrease(T* p)
+	{
+		node_type* n = p;
+		XTL_ITERATOR_ASSERT1(n->is_linked());
+		if (n == _root) return;
+		cut(n);
+		_root = meld(_root, n);
+	}
+
+	/// Restore the heap order after the key of p has changed in either
+	/// direction.
+	/// @remarks Complexity O(log N) amortized.
+	void update(T* p)
+	{
+		erase(p);
+		push(p);
+	}
+
+	/// Move all elements of other into this heap.
+	/// @remarks Complexity O(1).
+	void merge(pairing_heap& other)
+	{
+		if (&other == this || other._root == 0) return;
+		_root = (_root == 0)? other._root: meld(_root, other._root);
+		_size += other._size;
+		other._root = 0;
+		other._size = 0;
+	}
+
+	/// Unlink all elements.
+	/// @remarks Complexity O(N).
+	void clear()
+	{
+		// Flatten the tree by splicing each child list in after its parent
+		for (node_type* n = _root; n != 0; )
+		{
+			if (n->_child != 0)
+			{
+				node_type* last = n->_child;
+				while (last->_next != 0)
+					last = last->_next;
+				last->_next = n->_next;
+				n->_next = n->_child;
+			}
+			node_type* next = n->_next;
+			n->reset();
+			n = next;
+		}
+		_root = 0;
+		_size = 0;
+	}
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(PAIRING_HEAP_E41A6C93_2D7F_4B58_A0C6_59F83B1D27E4)
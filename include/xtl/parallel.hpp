@@ -0,0 +1,140 @@
+#ifndef PARALLEL_57D4477E_DB8B_447F_8096_CE5CFB94E5DE
+#define PARALLEL_57D4477E_DB8B_447F_8096_CE5CFB94E5DE
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Helpers for splitting container operations across threads.
+/// @author Paul Glendenning
+/// @date
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+/// Ranges smaller than this are not worth handing to another thread.
+#ifndef	XTL_PARALLEL_MIN_CHUNK
+#define	XTL_PARALLEL_MIN_CHUNK	4096
+#endif
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// Get the number of chunks parallel_for_chunks() should split a range of n
+/// elements into.
+/// @param	n			The range size.
+/// @param	nthreads	The maximum number of threads. Zero selects the hardware
+///						concurrency.
+/// @return	The number of chunks. Always at least one.
+inline unsigned parallel_chunks(size_t n, unsigned nthreads=0)
+{
+	if (nthreads == 0)
+		nthreads = std::max(1U, std::thread::hardware_concurrency());
+	size_t maxChunks = (n + XTL_PARALLEL_MIN_CHUNK - 1)/XTL_PARALLEL_MIN_CHUNK;
+	return (unsigned)std::max<size_t>(1, std::min<size_t>(nthreads, maxChunks));
+}
+
+/// Split the index range [0,n) into nchunks contiguous chunks and call
+/// f(first, last, chunk) for each chunk. Chunk 0 runs on the calling thread,
+/// the remainder each run on their own thread. The function returns when all
+/// chunks are complete.
+/// @remarks The function object must not throw.
+template<class Function>
+void parallel_for_chunks(size_t n, unsigned nchunks, Function f)
+{
+	if (nchunks <= 1)
+	{
+		f(size_t(0), n, 0U);
+		return;
+	}
+	std::vector<std::thread> threads;
+	threads.reserve(nchunks-1);
+	for (unsigned c=1; c<nchunks; ++c)
+		threads.push_back(std::thread(f, n*c/nchunks, n*(c+1)/nchunks, c));
+	f(size_t(0), n/nchunks, 0U);
+	for (size_t i=0; i<threads.size(); ++i)
+		threads[i].join();
+}
+
+/// Execution policy which runs an operation on the calling thread.
+struct sequenced_policy { };
+
+/// Execution policy which splits an operation across threads.
+struct parallel_policy
+{
+	/// The maximum number of threads. Zero selects the hardware concurrency.
+	unsigned threads;
+	explicit parallel_policy(unsigned nthreads=0): threads(nthreads) { }
+};
+
+/// @{
+/// Policy instances, use as m.sort(xtl::par).
+const sequenced_policy seq = sequenced_policy();
+const parallel_policy par = parallel_policy();
+/// @}
+
+/// Sort [first,last) using up to nthreads threads. The range is split into
+/// chunks which are sorted concurrently, then adjacent runs are merged pairwise
+/// with each round of merges also run concurrently.
+/// @remarks Complexity O(N log N) work, O((N/P) log N + N) elapsed for P
+/// threads. The sort is not stable. The comparison must not throw.
+template<class RandomIt, class Compare>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp, unsigned nthreads=0)
+{
+	size_t n = size_t(last - first);
+	unsigned nchunks = parallel_chunks(n, nthreads);
+	if (nchunks <= 1)
+	{
+		std::sort(first, last, comp);
+		return;
+	}
+	parallel_for_chunks(n, nchunks, [&](size_t b, size_t e, unsigned) {
+		std::sort(first + b, first + e, comp);
+	});
+	// Run boundaries match the chunks used by parallel_for_chunks()
+	std::vector<size_t> bounds(nchunks+1);
+	for (unsigned c=0; c<=nchunks; ++c)
+		bounds[c] = n*c/nchunks;
+	while (bounds.size() > 2)
+	{
+		size_t pairs = (bounds.size()-1)/2;
+		parallel_for_chunks(pairs, unsigned(pairs), [&](size_t b, size_t e, unsigned) {
+			for (size_t i=b; i<e; ++i)
+				std::inplace_merge(first + bounds[2*i], first + bounds[2*i+1], first + bounds[2*i+2], comp);
+		});
+		std::vector<size_t> merged;
+		for (size_t i=0; i<bounds.size(); i+=2)
+			merged.push_back(bounds[i]);
+		if (merged.back() != n)
+			merged.push_back(n);
+		bounds.swap(merged);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(PARALLEL_57D4477E_DB8B_447F_8096_CE5CFB94E5DE)
@@ -29,6 +29,7 @@
 // author Paul Glendenning
 
 #include <cassert>
+#include <atomic>
 
 /// Property declaration
 /// Use at the root namespace scope but not within structures or classes.
@@ -86,6 +87,22 @@ template<class Key, class T, class A=std::allocator<std::pair<const Key, T> > cl
 #define	XTL_ITERATOR_ASSERT2(x)	void(0)
 #endif
 
+/// Containers count hot path events in container_stats when XTL_CONTAINER_STATS
+/// is non zero. The default is zero, which removes the counters entirely. As
+/// with XTL_ITERATOR_CHECKS the setting changes container layout, so every
+/// translation unit in a program must use the same setting.
+#ifndef	XTL_CONTAINER_STATS
+#define	XTL_CONTAINER_STATS		0
+#endif
+
+#if XTL_CONTAINER_STATS != 0
+#define	XTL_STATS_COUNT(counter)			xtl::container_stats_counters::count(_stats.counter)
+#define	XTL_STATS_COUNT_IF(cond, counter)	void((cond)? xtl::container_stats_counters::count(_stats.counter): void(0))
+#else
+#define	XTL_STATS_COUNT(counter)			void(0)
+#define	XTL_STATS_COUNT_IF(cond, counter)	void(0)
+#endif
+
 namespace xtl {
 //-----------------------------------------------------------------------------
 
@@ -164,6 +181,83 @@ struct container_traits
 };
 
 
+/// Hot path event counts of a container. Only maintained when XTL_CONTAINER_STATS
+/// is non zero, otherwise stats() always returns zeros.
+struct container_stats
+{
+	/// Growth of the key index. Reallocations for the flat index, index
+	/// block allocations for a block index.
+	size_t	remaps;
+	/// Element storage allocations, vector reallocations or new blocks.
+	size_t	grows;
+	/// Calls to find().
+	size_t	finds;
+	/// Calls to find() which did not find the key.
+	size_t	find_misses;
+	/// Erases which moved another element into the hole.
+	size_t	erase_swaps;
+
+	container_stats(): remaps(0), grows(0), finds(0), find_misses(0), erase_swaps(0) { }
+
+	container_stats& operator += (const container_stats& other)
+	{
+		remaps += other.remaps;
+		grows += other.grows;
+		finds += other.finds;
+		find_misses += other.find_misses;
+		erase_swaps += other.erase_swaps;
+		return *this;
+	}
+};
+
+/// @cond
+// The counters behind container_stats when XTL_CONTAINER_STATS is non zero.
+// Counters are atomic so counting in the const members of a container shared
+// by reader threads is neither a data race nor loses counts.
+struct container_stats_counters
+{
+	std::atomic<size_t>	remaps;
+	std::atomic<size_t>	grows;
+	std::atomic<size_t>	finds;
+	std::atomic<size_t>	find_misses;
+	std::atomic<size_t>	erase_swaps;
+
+	container_stats_counters() { store(container_stats()); }
+	container_stats_counters(const container_stats_counters& other) { store(other.load()); }
+	container_stats_counters& operator = (const container_stats_counters& other)
+	{
+		store(other.load());
+		return *this;
+	}
+
+	static void count(std::atomic<size_t>& counter)
+	{
+		counter.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	container_stats load() const
+	{
+		container_stats s;
+		s.remaps = remaps.load(std::memory_order_relaxed);
+		s.grows = grows.load(std::memory_order_relaxed);
+		s.finds = finds.load(std::memory_order_relaxed);
+		s.find_misses = find_misses.load(std::memory_order_relaxed);
+		s.erase_swaps = erase_swaps.load(std::memory_order_relaxed);
+		return s;
+	}
+
+	void store(const container_stats& s)
+	{
+		remaps.store(s.remaps, std::memory_order_relaxed);
+		grows.store(s.grows, std::memory_order_relaxed);
+		finds.store(s.finds, std::memory_order_relaxed);
+		find_misses.store(s.find_misses, std::memory_order_relaxed);
+		erase_swaps.store(s.erase_swaps, std::memory_order_relaxed);
+	}
+};
+/// @endcond
+
+
 /// @cond
 template<class T>
 struct __set_traits
@@ -0,0 +1,274 @@
+#ifndef RADIX_SORT_E2B7F4A9_1C58_4D36_8A0F_73C95E1D2B64
+#define RADIX_SORT_E2B7F4A9_1C58_4D36_8A0F_73C95E1D2B64
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	LSD radix sort for integer keyed ranges.
+/// @author Paul Glendenning
+/// @date
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bitmagic.hpp"
+#include "parallel.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// @cond
+// Map an integer key to an unsigned value with the same ordering.
+template<class Key>
+inline uint64_t radix_key(Key k)
+{
+	typedef typename std::make_unsigned<Key>::type ukey_type;
+	ukey_type u = ukey_type(k);
+	if (std::numeric_limits<Key>::is_signed)
+		u ^= ukey_type(1) << (sizeof(Key)*8 - 1);
+	return uint64_t(u);
+}
+
+template<class T>
+struct radix_identity
+{
+	const T& operator () (const T& x) const { return x; }
+};
+/// @endcond
+
+/// Sort [first,last) by an integer key using a stable least significant digit
+/// radix sort.
+///
+/// A single pass over the range builds the histograms of all digits and the
+/// mask of key bits which differ from the first key. Digits with no differing
+/// bits are skipped, so a range whose keys span 2^20 values needs two passes
+/// of 11 bit digits whatever the key width.
+///
+/// @param	first	The start of the range.
+/// @param	last	The end of the range.
+/// @param	keyof	Returns the integer key of an element.
+/// @param DigitBits	The digit width. Each pass uses a histogram of
+///						2^DigitBits counters.
+/// @remarks Complexity O(N * passes). Uses a temporary buffer of N elements.
+template<unsigned DigitBits, class RandomIt, class KeyOf>
+void radix_sort(RandomIt first, RandomIt last, KeyOf keyof)
+{
+	typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+	typedef typename std::remove_cv<typename std::remove_reference<decltype(keyof(*first))>::type>::type key_type;
+	enum {
+		RADIX = 1 << DigitBits,
+		KEY_BITS = sizeof(key_type)*8,
+		PASSES = (KEY_BITS + DigitBits - 1) / DigitBits
+	};
+	const size_t n = size_t(last - first);
+	if (n < 2) return;
+
+	// Histograms of every digit and the differing bits in one pass
+	std::vector<size_t> counts(size_t(PASSES)*RADIX, 0);
+	uint64_t base = radix_key(keyof(*first));
+	uint64_t diff = 0;
+	for (RandomIt it=first; it!=last; ++it)
+	{
+		uint64_t k = radix_key(keyof(*it));
+		diff |= k ^ base;
+		for (unsigned p=0; p<PASSES; ++p)
+			++counts[p*RADIX + ((k >> (p*DigitBits)) & (RADIX-1))];
+	}
+	if (diff == 0) return;
+	unsigned passes = unsigned(bitmagic<uint64_t>::floor_log2(diff) / DigitBits + 1);
+
+	std::vector<value_type> buffer(n);
+	bool inBuffer = false;
+	std::vector<size_t> offsets(RADIX);
+	for (unsigned p=0; p<passes; ++p)
+	{
+		if (((diff >> (p*DigitBits)) & (RADIX-1)) == 0)
+			continue;
+		size_t sum = 0;
+		for (unsigned d=0; d<RADIX; ++d)
+		{
+			offsets[d] = sum;
+			sum += counts[p*RADIX + d];
+		}
+		const unsigned shift = p*DigitBits;
+		if (inBuffer)
+		{
+			for (typename std::vector<value_type>::iterator it=buffer.begin(); it!=buffer.end(); ++it)
+				*(first + offsets[(radix_key(keyof(*it)) >> shift) & (RADIX-1)]++) = std::move(*it);
+		}
+		else
+		{
+			for (RandomIt it=first; it!=last; ++it)
+				buffer[offsets[(radix_key(keyof(*it)) >> shift) & (RADIX-1)]++] = std::move(*it);
+		}
+		inBuffer = !inBuffer;
+	}
+	if (inBuffer)
+		std::move(buffer.begin(), buffer.end(), first);
+}
+
+/// Sort [first,last) by an integer key using 11 bit digits.
+/// @see	radix_sort<DigitBits>().
+template<class RandomIt, class KeyOf>
+void radix_sort(RandomIt first, RandomIt last, KeyOf keyof)
+{
+	radix_sort<11>(first, last, keyof);
+}
+
+/// Sort a range of integers.
+/// @see	radix_sort<DigitBits>().
+template<class RandomIt>
+void radix_sort(RandomIt first, RandomIt last)
+{
+	radix_sort<11>(first, last, radix_identity<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+/// @cond
+// Count the digits of one chunk of a parallel radix sort pass.
+template<unsigned DigitBits, class InputIt, class KeyOf>
+void radix_count_chunk(InputIt first, InputIt last, KeyOf keyof, unsigned shift, size_t* counts)
+{
+	for (; first!=last; ++first)
+		++counts[(radix_key(keyof(*first)) >> shift) & ((1U << DigitBits)-1)];
+}
+
+// Scatter one chunk of a parallel radix sort pass. The offsets of the chunk
+// are advanced as elements are moved.
+template<unsigned DigitBits, class InputIt, class OutputIt, class KeyOf>
+void radix_scatter_chunk(InputIt first, InputIt last, OutputIt out, KeyOf keyof, unsigned shift, size_t* offsets)
+{
+	for (; first!=last; ++first)
+		*(out + offsets[(radix_key(keyof(*first)) >> shift) & ((1U << DigitBits)-1)]++) = std::move(*first);
+}
+/// @endcond
+
+/// Sort [first,last) by an integer key using a stable least significant digit
+/// radix sort split across up to nthreads threads.
+///
+/// The range is split into the chunks used by parallel_for_chunks(). Each pass
+/// counts the digits of every chunk concurrently, a prefix sum over the digits
+/// in chunk order gives each chunk its own output offsets, and the chunks are
+/// then scattered concurrently. Chunk order within a digit keeps the sort
+/// stable. Digits with no differing bits are skipped as for radix_sort().
+///
+/// @param	first		The start of the range.
+/// @param	last		The end of the range.
+/// @param	keyof		Returns the integer key of an element.
+/// @param	nthreads	The maximum number of threads. Zero selects the hardware
+///						concurrency.
+/// @param DigitBits	The digit width. Each chunk uses a histogram of
+///						2^DigitBits counters.
+/// @remarks Complexity O(N * passes) work, O((N/P + P*2^DigitBits) * passes)
+/// elapsed for P threads. Uses a temporary buffer of N elements. The key
+/// function must not throw.
+template<unsigned DigitBits, class RandomIt, class KeyOf>
+void parallel_radix_sort(RandomIt first, RandomIt last, KeyOf keyof, unsigned nthreads=0)
+{
+	typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+	enum { RADIX = 1 << DigitBits };
+	const size_t n = size_t(last - first);
+	const unsigned nchunks = parallel_chunks(n, nthreads);
+	if (nchunks <= 1)
+	{
+		radix_sort<DigitBits>(first, last, keyof);
+		return;
+	}
+
+	// Differing key bits of each chunk
+	const uint64_t base = radix_key(keyof(*first));
+	std::vector<uint64_t> diffs(nchunks, 0);
+	parallel_for_chunks(n, nchunks, [&](size_t b, size_t e, unsigned c) {
+		uint64_t d = 0;
+		for (RandomIt it=first+b; it!=first+e; ++it)
+			d |= radix_key(keyof(*it)) ^ base;
+		diffs[c] = d;
+	});
+	uint64_t diff = 0;
+	for (unsigned c=0; c<nchunks; ++c)
+		diff |= diffs[c];
+	if (diff == 0) return;
+	unsigned passes = unsigned(bitmagic<uint64_t>::floor_log2(diff) / DigitBits + 1);
+
+	std::vector<value_type> buffer(n);
+	bool inBuffer = false;
+	// Row c holds the counts, then the offsets, of chunk c
+	std::vector<size_t> table(size_t(nchunks)*RADIX);
+	for (unsigned p=0; p<passes; ++p)
+	{
+		if (((diff >> (p*DigitBits)) & (RADIX-1)) == 0)
+			continue;
+		const unsigned shift = p*DigitBits;
+		parallel_for_chunks(n, nchunks, [&](size_t b, size_t e, unsigned c) {
+			size_t* counts = &table[size_t(c)*RADIX];
+			std::fill(counts, counts + RADIX, size_t(0));
+			if (inBuffer)
+				radix_count_chunk<DigitBits>(buffer.begin()+b, buffer.begin()+e, keyof, shift, counts);
+			else
+				radix_count_chunk<DigitBits>(first+b, first+e, keyof, shift, counts);
+		});
+		size_t sum = 0;
+		for (unsigned d=0; d<RADIX; ++d)
+		{
+			for (unsigned c=0; c<nchunks; ++c)
+			{
+				size_t count = table[size_t(c)*RADIX + d];
+				table[size_t(c)*RADIX + d] = sum;
+				sum += count;
+			}
+		}
+		parallel_for_chunks(n, nchunks, [&](size_t b, size_t e, unsigned c) {
+			size_t* offsets = &table[size_t(c)*RADIX];
+			if (inBuffer)
+				radix_scatter_chunk<DigitBits>(buffer.begin()+b, buffer.begin()+e, first, keyof, shift, offsets);
+			else
+				radix_scatter_chunk<DigitBits>(first+b, first+e, buffer.begin(), keyof, shift, offsets);
+		});
+		inBuffer = !inBuffer;
+	}
+	if (inBuffer)
+	{
+		parallel_for_chunks(n, nchunks, [&](size_t b, size_t e, unsigned) {
+			std::move(buffer.begin()+b, buffer.begin()+e, first+b);
+		});
+	}
+}
+
+/// Sort [first,last) by an integer key using 11 bit digits and up to nthreads
+/// threads.
+/// @see	parallel_radix_sort<DigitBits>().
+template<class RandomIt, class KeyOf>
+void parallel_radix_sort(RandomIt first, RandomIt last, KeyOf keyof, unsigned nthreads=0)
+{
+	parallel_radix_sort<11>(first, last, keyof, nthreads);
+}
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(RADIX_SORT_E2B7F4A9_1C58_4D36_8A0F_73C95E1D2B64)
@@ -0,0 +1,267 @@
+#ifndef RCU_SNAPSHOT_2C6F8A1E_94B3_4D7A_B5E0_37D1C9F24A68
+#define RCU_SNAPSHOT_2C6F8A1E_94B3_4D7A_B5E0_37D1C9F24A68
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Read-copy-update publishing of immutable snapshots.
+/// @author Paul Glendenning
+/// @date
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include "property.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// An rcu_snapshot holds the current version of a read mostly object, such as
+/// an unordered_vector_map, and lets readers use it without ever blocking.
+///
+/// A writer builds a new version off to the side, typically starting from
+/// clone(), and publish()es it with one atomic exchange. The previous version
+/// is retired and deleted by reclaim() once no reader can still see it.
+///
+/// Reclamation is epoch based. Each reading thread owns a reader, which holds a
+/// slot in a fixed size table. A guard records the global epoch in the slot for
+/// its lifetime. A version retired at epoch E is freed when every active slot
+/// has an epoch not less than E.
+///
+/// @code
+/// typedef unordered_vector_map<unsigned,route> routes_type;
+/// rcu_snapshot<routes_type> table(new routes_type);
+/// // Reader thread
+/// rcu_snapshot<routes_type>::reader r(table);
+/// {
+///     rcu_snapshot<routes_type>::guard g(r);
+///     routes_type::const_iterator it = g->find(key);
+/// }
+/// // Writer thread
+/// routes_type* next = table.clone();
+/// (*next)[key] = x;
+/// table.publish(next);
+/// @endcode
+///
+/// @param T	The snapshot type. Published versions are treated as immutable.
+/// @remarks Entering and leaving a guard costs one load, two stores and a full
+/// fence. Lookups through the guard cost the same as on a plain T.
+template<class T>
+class rcu_snapshot
+{
+public:
+	typedef T	value_type;
+private:
+	/// @cond
+	enum { CACHE_LINE = 64 };
+	// Zero marks a quiescent slot, so epochs start at one. Each slot fills a
+	// cache line, and the table is line aligned, so readers on different
+	// threads never write to the same line.
+	struct slot
+	{
+		std::atomic<size_t>	epoch;
+		std::atomic<bool>	used;
+		char				pad[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(std::atomic<bool>)];
+	};
+	typedef std::pair<T*, size_t>	retired_type;
+
+	std::atomic<T*>			_current;
+	std::atomic<size_t>		_epoch;
+	// Raw storage for the slot table, over allocated by a line for alignment
+	char*					_storage;
+	slot*					_slots;
+	unsigned				_maxReaders;
+	std::mutex				_writer;
+	std::vector<retired_type> _retired;
+
+	rcu_snapshot(const rcu_snapshot&);
+	rcu_snapshot& operator = (const rcu_snapshot&);
+
+	slot* acquire_slot()
+	{
+		for (unsigned i=0; i<_maxReaders; ++i)
+		{
+			bool expected = false;
+			if (_slots[i].used.compare_exchange_strong(expected, true))
+				return &_slots[i];
+		}
+		return 0;
+	}
+
+	// Oldest epoch any reader may still be using. Call with _writer held.
+	size_t min_active_epoch() const
+	{
+		size_t e = _epoch.load();
+		for (unsigned i=0; i<_maxReaders; ++i)
+		{
+			size_t x = _slots[i].epoch.load();
+			if (x != 0 && x < e) e = x;
+		}
+		return e;
+	}
+
+	// Call with _writer held.
+	size_t reclaim_locked()
+	{
+		size_t e = min_active_epoch();
+		size_t j = 0;
+		for (size_t i=0; i<_retired.size(); ++i)
+		{
+			if (_retired[i].second <= e)
+				delete _retired[i].first;
+			else
+				_retired[j++] = _retired[i];
+		}
+		_retired.resize(j);
+		return j;
+	}
+	/// @endcond
+
+public:
+	class guard;
+
+	/// A reader owns one reader slot. Create one per reading thread and keep it
+	/// for the lifetime of the thread. A reader must not be shared by threads.
+	class reader
+	{
+		friend class guard;
+		rcu_snapshot*	_owner;
+		slot*			_slot;
+
+		reader(const reader&);
+		reader& operator = (const reader&);
+	public:
+		/// Claim a slot.
+		/// @throw	std::runtime_error if all slots are in use.
+		explicit reader(rcu_snapshot& owner): _owner(&owner), _slot(owner.acquire_slot())
+		{
+			if (_slot == 0)
+				throw std::runtime_error("rcu_snapshot: too many readers");
+		}
+		/// Release the slot.
+		~reader()
+		{
+			_slot->epoch.store(0);
+			_slot->used.store(false);
+		}
+	};
+
+	/// A guard pins the current snapshot for its lifetime. Guards must not be
+	/// nested on the same reader.
+	class guard
+	{
+		std::atomic<size_t>* _epoch;
+		const T*			_value;
+
+		guard(const guard&);
+		guard& operator = (const guard&);
+	public:
+		explicit guard(reader& r): _epoch(&r._slot->epoch)
+		{
+			XTL_ITERATOR_ASSERT1(_epoch->load(std::memory_order_relaxed) == 0);
+			// The slot store must be visible before the pointer is loaded, which
+			// the sequentially consistent store and load ensure.
+			_epoch->store(r._owner->_epoch.load());
+			_value = r._owner->_current.load();
+		}
+		~guard() { _epoch->store(0, std::memory_order_release); }
+
+		const T* get() const { return _value; }
+		const T& operator * () const { return *_value; }
+		const T* operator -> () const { return _value; }
+	};
+
+	/// Create with an initial version.
+	/// @param	initial		The first version, ownership is taken. May be null.
+	/// @param	maxReaders	The maximum number of concurrent reader objects.
+	explicit rcu_snapshot(T* initial=0, unsigned maxReaders=64):
+		_current(initial), _epoch(1), _storage(new char[(maxReaders+1)*sizeof(slot)]), _slots(0), _maxReaders(maxReaders)
+	{
+		uintptr_t p = (reinterpret_cast<uintptr_t>(_storage) + CACHE_LINE - 1) & ~uintptr_t(CACHE_LINE - 1);
+		_slots = reinterpret_cast<slot*>(p);
+		for (unsigned i=0; i<_maxReaders; ++i)
+		{
+			::new (static_cast<void*>(_slots + i)) slot();
+			_slots[i].epoch.store(0);
+			_slots[i].used.store(false);
+		}
+	}
+
+	/// Destructor. No readers may remain.
+	~rcu_snapshot()
+	{
+		for (size_t i=0; i<_retired.size(); ++i)
+			delete _retired[i].first;
+		delete _current.load();
+		for (unsigned i=0; i<_maxReaders; ++i)
+			_slots[i].~slot();
+		delete [] _storage;
+	}
+
+	/// Make a copy of the current version for a writer to modify and publish.
+	/// @return	A new object, or null if no version has been published.
+	T* clone()
+	{
+		std::lock_guard<std::mutex> lock(_writer);
+		T* p = _current.load();
+		return p? new T(*p): 0;
+	}
+
+	/// Replace the current version. Readers which already hold a guard keep
+	/// seeing the old version, new guards see next. The old version is retired
+	/// and reclaim() is run.
+	/// @param	next	The new version, ownership is taken.
+	/// @remarks Complexity O(maxReaders + retired versions).
+	void publish(T* next)
+	{
+		std::lock_guard<std::mutex> lock(_writer);
+		T* old = _current.exchange(next);
+		// Readers entering at or after this epoch load next.
+		size_t e = ++_epoch;
+		if (old) _retired.push_back(retired_type(old, e));
+		reclaim_locked();
+	}
+
+	/// Free retired versions that no reader can still see.
+	/// @return	The number of versions still waiting for readers to leave.
+	size_t reclaim()
+	{
+		std::lock_guard<std::mutex> lock(_writer);
+		return reclaim_locked();
+	}
+
+	/// Get the epoch, incremented by each publish().
+	size_t epoch() const { return _epoch.load(); }
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(RCU_SNAPSHOT_2C6F8A1E_94B3_4D7A_B5E0_37D1C9F24A68)
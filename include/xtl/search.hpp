@@ -0,0 +1,85 @@
+#ifndef SEARCH_B36C0E2A_5D41_4F8C_9A77_1E2F6C4D8B90
+#define SEARCH_B36C0E2A_5D41_4F8C_9A77_1E2F6C4D8B90
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Branch free binary search over sorted random access ranges.
+/// @author Paul Glendenning
+/// @date
+
+#include <cstddef>
+#include <iterator>
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// Find the first element in the sorted range [first,last) for which
+/// comp(element, value) is false. Equivalent to std::lower_bound() but the loop
+/// body has no data dependent branch, so the compiler can use a conditional
+/// move and the loop count depends only on the range size.
+/// @param	first	The start of the range.
+/// @param	last	The end of the range.
+/// @param	value	The value to search for.
+/// @param	comp	Returns true if the element is ordered before value.
+/// @remarks Complexity O(log N) compares, always ceil(log2(N))+1.
+template<class RandomIt, class T, class Compare>
+RandomIt branchless_lower_bound(RandomIt first, RandomIt last, const T& value, Compare comp)
+{
+	typedef typename std::iterator_traits<RandomIt>::difference_type difference_type;
+	difference_type n = last - first;
+	if (n == 0) return first;
+	while (n > 1)
+	{
+		difference_type half = n / 2;
+		first += comp(*(first + half), value)? half: 0;
+		n -= half;
+	}
+	return first + (comp(*first, value)? 1: 0);
+}
+
+/// Find the first element in the sorted range [first,last) for which
+/// comp(value, element) is true. Equivalent to std::upper_bound().
+/// @see	branchless_lower_bound().
+template<class RandomIt, class T, class Compare>
+RandomIt branchless_upper_bound(RandomIt first, RandomIt last, const T& value, Compare comp)
+{
+	typedef typename std::iterator_traits<RandomIt>::difference_type difference_type;
+	difference_type n = last - first;
+	if (n == 0) return first;
+	while (n > 1)
+	{
+		difference_type half = n / 2;
+		first += comp(value, *(first + half))? 0: half;
+		n -= half;
+	}
+	return first + (comp(value, *first)? 0: 1);
+}
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(SEARCH_B36C0E2A_5D41_4F8C_9A77_1E2F6C4D8B90)
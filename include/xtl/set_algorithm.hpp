@@ -0,0 +1,178 @@
+#ifndef SET_ALGORITHM_D406226E_8F1A_47F8_BF1F_3FF75D781514
+#define SET_ALGORITHM_D406226E_8F1A_47F8_BF1F_3FF75D781514
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Set operations on the keys of the XTL vector sets and maps. Because
+///			membership is tested in O(1) using the container's sparse index the
+///			operands do not need to be sorted.
+/// @author Paul Glendenning
+/// @date
+
+#include <vector>
+#include "property.hpp"
+#include "parallel.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+// All functions require the probed container to provide test() and find(), as
+// unordered_vector_set<>, unordered_vector_map<> and unordered_block_vector_map<>
+// do. The output container must not be one of the operands.
+
+/// Out of place set intersection. Elements of a whose key is in b are inserted
+/// into out.
+/// @remarks Complexity O(min(a.size(), b.size())). The smaller container is
+/// iterated and each key is probed in the larger.
+template<class A, class B, class Out>
+void set_intersection(const A& a, const B& b, Out& out)
+{
+	if (b.size() < a.size())
+	{
+		for (typename B::const_iterator i=b.begin(); i!=b.end(); ++i)
+		{
+			typename A::const_iterator x = a.find(container_traits<B>::key_from_value(*i));
+			if (x != a.end())
+				out.insert(*x);
+		}
+	}
+	else
+	{
+		for (typename A::const_iterator i=a.begin(); i!=a.end(); ++i)
+		{
+			if (b.test(container_traits<A>::key_from_value(*i)))
+				out.insert(*i);
+		}
+	}
+}
+
+/// Out of place set difference. Elements of a whose key is not in b are inserted
+/// into out.
+/// @remarks Complexity O(a.size()).
+template<class A, class B, class Out>
+void set_difference(const A& a, const B& b, Out& out)
+{
+	for (typename A::const_iterator i=a.begin(); i!=a.end(); ++i)
+	{
+		if (!b.test(container_traits<A>::key_from_value(*i)))
+			out.insert(*i);
+	}
+}
+
+/// Out of place set union. All elements of a, and the elements of b whose key
+/// is not in a, are inserted into out.
+/// @remarks Complexity O(a.size() + b.size()).
+template<class A, class B, class Out>
+void set_union(const A& a, const B& b, Out& out)
+{
+	for (typename A::const_iterator i=a.begin(); i!=a.end(); ++i)
+		out.insert(*i);
+	set_difference(b, a, out);
+}
+
+/// @cond
+// Call select on each element of c in parallel chunks. Select returns a pointer
+// to the element to insert into out, or null. Insertion into out is serial and
+// preserves the iteration order of c.
+template<class V, class C, class Select, class Out>
+void __parallel_select(const C& c, const Select& select, Out& out, unsigned nthreads)
+{
+	unsigned nchunks = parallel_chunks(c.size(), nthreads);
+	std::vector<std::vector<const V*> > found(nchunks);
+	parallel_for_chunks(c.size(), nchunks, [&](size_t first, size_t last, unsigned chunk)
+	{
+		std::vector<const V*>& v = found[chunk];
+		typename C::const_iterator i = c.begin() + (std::ptrdiff_t)first;
+		for (; first != last; ++first, ++i)
+		{
+			const V* p = select(*i);
+			if (p) v.push_back(p);
+		}
+	});
+	for (unsigned k=0; k<nchunks; ++k)
+	{
+		for (size_t j=0; j<found[k].size(); ++j)
+			out.insert(*found[k][j]);
+	}
+}
+/// @endcond
+
+/// Parallel set_intersection(). The smaller container is split into chunks which
+/// are probed concurrently.
+/// @param	nthreads	The maximum number of threads. Zero selects the hardware
+///						concurrency.
+template<class A, class B, class Out>
+void parallel_set_intersection(const A& a, const B& b, Out& out, unsigned nthreads=0)
+{
+	typedef typename A::value_type value_type;
+	if (b.size() < a.size())
+	{
+		__parallel_select<value_type>(b, [&a](const typename B::value_type& v) -> const value_type*
+		{
+			typename A::const_iterator x = a.find(container_traits<B>::key_from_value(v));
+			return (x != a.end())? &*x: 0;
+		}, out, nthreads);
+	}
+	else
+	{
+		__parallel_select<value_type>(a, [&b](const value_type& v) -> const value_type*
+		{
+			return b.test(container_traits<A>::key_from_value(v))? &v: 0;
+		}, out, nthreads);
+	}
+}
+
+/// Parallel set_difference(). The container a is split into chunks which are
+/// probed concurrently.
+/// @param	nthreads	The maximum number of threads. Zero selects the hardware
+///						concurrency.
+template<class A, class B, class Out>
+void parallel_set_difference(const A& a, const B& b, Out& out, unsigned nthreads=0)
+{
+	typedef typename A::value_type value_type;
+	__parallel_select<value_type>(a, [&b](const value_type& v) -> const value_type*
+	{
+		return b.test(container_traits<A>::key_from_value(v))? 0: &v;
+	}, out, nthreads);
+}
+
+/// Parallel set_union(). The container a is copied to out and then b is split into
+/// chunks which are probed concurrently.
+/// @param	nthreads	The maximum number of threads. Zero selects the hardware
+///						concurrency.
+template<class A, class B, class Out>
+void parallel_set_union(const A& a, const B& b, Out& out, unsigned nthreads=0)
+{
+	for (typename A::const_iterator i=a.begin(); i!=a.end(); ++i)
+		out.insert(*i);
+	parallel_set_difference(b, a, out, nthreads);
+}
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(SET_ALGORITHM_D406226E_8F1A_47F8_BF1F_3FF75D781514)
@@ -0,0 +1,356 @@
+#ifndef SHARDED_VECTOR_MAP_7E1D2C94_3A6B_4F05_8C2D_5B9E0A41F6D3
+#define SHARDED_VECTOR_MAP_7E1D2C94_3A6B_4F05_8C2D_5B9E0A41F6D3
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	A sharded unordered_vector_map for concurrent writers and lock free readers.
+/// @author Paul Glendenning
+/// @date
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "unordered_vector_map.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// A sharded_vector_map partitions the integer key space over 2^ShardBits
+/// independent unordered_vector_map shards. Writers lock a shard mutex, so
+/// threads writing keys in different shards do not contend.
+///
+/// The low ShardBits of the key select the shard and the remaining high bits are
+/// the key within the shard. Consecutive keys are spread over all shards and the
+/// total index size stays O(N), where N is the maximum key, rather than
+/// O(N * shards) if each shard indexed the full key domain.
+///
+/// Readers do not lock when the mapped type is trivially copyable. Each shard
+/// is a seqlock: a writer makes the shard version odd while it changes the
+/// shard, and a reader copies the value out then retries if the version moved.
+/// A shard never reallocates in place. A writer which needs more capacity
+/// publishes a grown copy and retires the old storage, which is only freed by
+/// the destructor, so an optimistic reader never touches freed memory. With
+/// geometric growth the retired storage is bounded by the live storage, and
+/// reserving the key domain up front avoids it entirely. Other mapped types
+/// are read under the shard mutex.
+///
+/// Each shard is padded to its own cache line so shards do not false share.
+///
+/// @param Key			The key type. Must be an unsigned or non-negative integer.
+/// @param T			The mapped type.
+/// @param ShardBits	Log2 of the number of shards.
+/// @param Alloc		Allocator function.
+/// @remarks The time complexity for insert, erase, and find is O(1). Writes
+/// add the cost of an uncontended mutex lock, optimistic reads a retry while a
+/// write to the same shard is in progress.
+template<class Key, class T, unsigned ShardBits=4, class Alloc=std::allocator<std::pair<Key,T> > >
+class sharded_vector_map
+{
+public:
+	typedef Key					key_type;
+	typedef T					mapped_type;
+	typedef std::pair<Key,T>	value_type;
+	typedef unordered_vector_map<Key,T,Alloc> shard_map_type;
+	enum {
+		SHARD_BITS = ShardBits,
+		SHARD_COUNT = 1 << ShardBits,
+		SHARD_MASK = SHARD_COUNT - 1
+	};
+	/// True if find() and test() read without locking.
+	static const bool optimistic_reads = std::is_trivially_copyable<T>::value;
+private:
+	/// @cond
+	enum { CACHE_LINE = 64 };
+	struct shard
+	{
+		mutable std::mutex					lock;
+		// Odd while a writer changes the shard map
+		std::atomic<unsigned>				version;
+		std::atomic<shard_map_type*>		map;
+		// Outgrown maps, kept for optimistic readers. Guarded by lock.
+		std::vector<shard_map_type*>		retired;
+		char								pad[CACHE_LINE];
+
+		shard(): version(0), map(new shard_map_type) { }
+		~shard()
+		{
+			delete map.load(std::memory_order_relaxed);
+			for (size_t i=0; i<retired.size(); ++i)
+				delete retired[i];
+		}
+	};
+	shard				_shards[SHARD_COUNT];
+
+	// Marks a shard as being written for its lifetime. Call with the shard
+	// locked.
+	class write_section
+	{
+		std::atomic<unsigned>&	_version;
+		write_section(const write_section&);
+		write_section& operator = (const write_section&);
+	public:
+		explicit write_section(shard& sh): _version(sh.version)
+		{
+			_version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		~write_section()
+		{
+			_version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+	};
+
+	static size_t shard_of(key_type key) { return size_t(key) & SHARD_MASK; }
+	static key_type local_key(key_type key) { return key_type(size_t(key) >> ShardBits); }
+	static key_type global_key(key_type local, size_t s) { return key_type((size_t(local) << ShardBits) | s); }
+
+	// Get the shard map with room for local keys in [0,capacity). The map is
+	// grown by publishing a copy so readers of the old map are not disturbed.
+	// Below its capacity a map never reallocates: keys are unique, so the
+	// elements never outnumber the index, and reserve() sizes the storage to
+	// the index. Call with the shard locked.
+	static shard_map_type* writable(shard& sh, size_t capacity)
+	{
+		shard_map_type* m = sh.map.load(std::memory_order_relaxed);
+		if (capacity <= m->capacity())
+			return m;
+		std::unique_ptr<shard_map_type> next(new shard_map_type(*m));
+		next->reserve(std::max(capacity, 2*m->capacity()));
+		sh.retired.push_back(m);
+		sh.map.store(next.get(), std::memory_order_release);
+		return next.release();
+	}
+
+	// Copy the value of local key out of a shard without locking. Retries
+	// while the shard version is odd or moves during the copy.
+	static bool read(const shard& sh, key_type local, mapped_type* value, std::true_type)
+	{
+		for (;;)
+		{
+			unsigned v = sh.version.load(std::memory_order_acquire);
+			if (v & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			const shard_map_type* m = sh.map.load(std::memory_order_acquire);
+			typename shard_map_type::const_iterator it = m->find(local);
+			bool found = it != m->end();
+			typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage_type;
+			storage_type copy = storage_type();
+			if (found && value)
+				std::memcpy(&copy, &it->second, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sh.version.load(std::memory_order_relaxed) != v)
+				continue;
+			if (found && value)
+				std::memcpy(value, &copy, sizeof(T));
+			return found;
+		}
+	}
+
+	static bool read(const shard& sh, key_type local, mapped_type* value, std::false_type)
+	{
+		std::lock_guard<std::mutex> guard(sh.lock);
+		const shard_map_type* m = sh.map.load(std::memory_order_relaxed);
+		typename shard_map_type::const_iterator it = m->find(local);
+		if (it == m->end())
+			return false;
+		if (value)
+			*value = it->second;
+		return true;
+	}
+
+	bool read(key_type key, mapped_type* value) const
+	{
+		return read(_shards[shard_of(key)], local_key(key), value, std::integral_constant<bool, optimistic_reads>());
+	}
+
+	sharded_vector_map(const sharded_vector_map&);
+	sharded_vector_map& operator = (const sharded_vector_map&);
+	/// @endcond
+
+public:
+	/// Create a sharded_vector_map with capacity for keys in [0,N).
+	sharded_vector_map(size_t N=0) { reserve(N); }
+
+	/// Reserve capacity for keys in [0,N).
+	/// @remarks Locks each shard in turn.
+	void reserve(size_t N)
+	{
+		size_t n = (N + SHARD_MASK) >> ShardBits;
+		for (size_t s=0; s<SHARD_COUNT; ++s)
+		{
+			std::lock_guard<std::mutex> guard(_shards[s].lock);
+			writable(_shards[s], n);
+		}
+	}
+
+	/// Get the number of elements. The result is a snapshot, shards are locked
+	/// in turn and not all at once.
+	size_t size() const
+	{
+		size_t n = 0;
+		for (size_t s=0; s<SHARD_COUNT; ++s)
+		{
+			std::lock_guard<std::mutex> guard(_shards[s].lock);
+			n += _shards[s].map.load(std::memory_order_relaxed)->size();
+		}
+		return n;
+	}
+
+	/// Get the heap memory held by all shards. Retired shard storage is
+	/// counted as overhead. The result is a snapshot in the same way as size().
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info;
+		for (size_t s=0; s<SHARD_COUNT; ++s)
+		{
+			const shard& sh = _shards[s];
+			std::lock_guard<std::mutex> guard(sh.lock);
+			info += sh.map.load(std::memory_order_relaxed)->memory_usage();
+			for (size_t i=0; i<sh.retired.size(); ++i)
+				info.overhead += sh.retired[i]->memory_usage().total();
+		}
+		return info;
+	}
+
+	/// @return True if no shard holds an element.
+	bool empty() const { return size() == 0; }
+
+	/// Remove all elements. Storage is kept.
+	void clear()
+	{
+		for (size_t s=0; s<SHARD_COUNT; ++s)
+		{
+			shard& sh = _shards[s];
+			std::lock_guard<std::mutex> guard(sh.lock);
+			write_section w(sh);
+			sh.map.load(std::memory_order_relaxed)->clear();
+		}
+	}
+
+	/// Insert an element if the key does not exist.
+	/// @return	True if inserted, false if the key already existed.
+	/// @remarks Complexity O(1).
+	bool insert(const value_type& v)
+	{
+		shard& sh = _shards[shard_of(v.first)];
+		key_type local = local_key(v.first);
+		std::lock_guard<std::mutex> guard(sh.lock);
+		shard_map_type* m = writable(sh, size_t(local)+1);
+		if (m->test(local))
+			return false;
+		write_section w(sh);
+		m->insert(std::make_pair(local, v.second));
+		return true;
+	}
+
+	/// Insert or overwrite the element at key.
+	/// @remarks Complexity O(1).
+	void assign(key_type key, const mapped_type& value)
+	{
+		shard& sh = _shards[shard_of(key)];
+		key_type local = local_key(key);
+		std::lock_guard<std::mutex> guard(sh.lock);
+		shard_map_type* m = writable(sh, size_t(local)+1);
+		write_section w(sh);
+		(*m)[local] = value;
+	}
+
+	/// Erase the element at key.
+	/// @return	True if an element was erased.
+	/// @remarks Complexity O(1).
+	bool erase(key_type key)
+	{
+		shard& sh = _shards[shard_of(key)];
+		key_type local = local_key(key);
+		std::lock_guard<std::mutex> guard(sh.lock);
+		shard_map_type* m = sh.map.load(std::memory_order_relaxed);
+		if (!m->test(local))
+			return false;
+		write_section w(sh);
+		m->erase(local);
+		return true;
+	}
+
+	/// Check if an element exists.
+	/// @remarks Complexity O(1). Does not lock if optimistic_reads.
+	bool test(key_type key) const { return read(key, 0); }
+
+	/// Copy the value at key.
+	/// @param	key		The key.
+	/// @param	value	Receives the value if found.
+	/// @return	True if found.
+	/// @remarks Complexity O(1). Does not lock if optimistic_reads.
+	bool find(key_type key, mapped_type& value) const { return read(key, &value); }
+
+	/// Call f(mapped_type&) on the value at key while its shard is locked. Use
+	/// this for read-modify-write updates.
+	/// @return	True if found.
+	/// @remarks Complexity O(1). f must not access this map.
+	template<class Function>
+	bool update(key_type key, Function f)
+	{
+		shard& sh = _shards[shard_of(key)];
+		std::lock_guard<std::mutex> guard(sh.lock);
+		shard_map_type* m = sh.map.load(std::memory_order_relaxed);
+		typename shard_map_type::iterator it = m->find(local_key(key));
+		if (it == m->end())
+			return false;
+		write_section w(sh);
+		f(it->second);
+		return true;
+	}
+
+	/// Call f(key, const mapped_type&) for every element. Each shard is locked
+	/// while it is visited so f must not access this map.
+	/// @remarks Complexity O(size()).
+	template<class Function>
+	void for_each(Function f) const
+	{
+		for (size_t s=0; s<SHARD_COUNT; ++s)
+		{
+			const shard& sh = _shards[s];
+			std::lock_guard<std::mutex> guard(sh.lock);
+			const shard_map_type* m = sh.map.load(std::memory_order_relaxed);
+			for (typename shard_map_type::const_iterator it=m->begin(); it!=m->end(); ++it)
+				f(global_key(it->first, s), it->second);
+		}
+	}
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(SHARDED_VECTOR_MAP_7E1D2C94_3A6B_4F05_8C2D_5B9E0A41F6D3)
@@ -0,0 +1,317 @@
+#ifndef SNAPSHOT_4A8E2F17_C63D_4B90_9E15_D07B3A6C2E58
+#define SNAPSHOT_4A8E2F17_C63D_4B90_9E15_D07B3A6C2E58
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	Binary snapshot format shared by the vector sets and maps.
+/// @author Paul Glendenning
+/// @date
+///
+/// A snapshot is a snapshot_header followed by the dense element array of the
+/// container in storage order. Loading reads the array straight into the
+/// container's storage and rebuilds the sparse index in one pass, which avoids
+/// the per element cost of insert().
+///
+/// Elements of trivially copyable types are written as raw bytes with one
+/// stream write per contiguous block. A std::pair is written field by field, so
+/// padding between the members never reaches the stream. Other types need a
+/// serializer, see snapshot_serializer<>.
+///
+/// Loading validates the snapshot before it is trusted. The element count must
+/// fit in the remaining stream and elements are read in bounded runs, keys must
+/// be less than the saved domain, and duplicate keys are rejected.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// Fixed size header at the start of every snapshot.
+struct snapshot_header
+{
+	enum {
+		MAGIC = 0x534c5458,		// "XTLS" little endian
+		VERSION = 2,
+		ORDER_MARK = 0x01020304
+	};
+	/// Container kinds
+	enum kind_type {
+		SET = 1,
+		MAP = 2
+	};
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	byte_order;
+	uint32_t	kind;
+	// The packed element size for raw snapshots, zero if a serializer wrote elements
+	uint32_t	value_size;
+	uint32_t	reserved;
+	// The number of elements which follow
+	uint64_t	count;
+	// An exclusive upper bound on the saved keys
+	uint64_t	domain;
+};
+
+/// The on disk layout of a raw element. Scalars are copied as is, a std::pair
+/// is packed field by field without the padding between its members.
+template<class T>
+struct snapshot_packed
+{
+	enum { size = sizeof(T) };
+	static char* pack(char* p, const T& v) { std::memcpy(p, &v, sizeof(T)); return p + sizeof(T); }
+	static const char* unpack(const char* p, T& v) { std::memcpy(&v, p, sizeof(T)); return p + sizeof(T); }
+};
+
+template<class A, class B>
+struct snapshot_packed<std::pair<A,B> >
+{
+	enum { size = snapshot_packed<A>::size + snapshot_packed<B>::size };
+	static char* pack(char* p, const std::pair<A,B>& v)
+	{
+		return snapshot_packed<B>::pack(snapshot_packed<A>::pack(p, v.first), v.second);
+	}
+	static const char* unpack(const char* p, std::pair<A,B>& v)
+	{
+		return snapshot_packed<B>::unpack(snapshot_packed<A>::unpack(p, v.first), v.second);
+	}
+};
+
+/// True if T can be saved as raw bytes. std::pair is not trivially copyable
+/// because it declares an assignment operator, but a pair of trivially copyable
+/// members has a trivial copy constructor and destructor so its bytes are its
+/// value.
+template<class T>
+struct snapshot_is_raw: public std::integral_constant<bool, std::is_trivially_copyable<T>::value> { };
+
+template<class A, class B>
+struct snapshot_is_raw<std::pair<A,B> >:
+	public std::integral_constant<bool, snapshot_is_raw<A>::value && snapshot_is_raw<B>::value> { };
+
+/// The default element serializer. Trivially copyable types are copied as raw
+/// bytes. Provide a class with the same members to save other types.
+///
+/// @code
+/// struct name_serializer {
+///     enum { raw = 0 };
+///     bool write(std::ostream& os, const std::pair<unsigned,std::string>& v) const;
+///     bool read(std::istream& is, std::pair<unsigned,std::string>& v) const;
+/// };
+/// m.save(os, name_serializer());
+/// @endcode
+template<class T>
+struct snapshot_serializer
+{
+	static_assert(snapshot_is_raw<T>::value,
+		"snapshot_serializer<T> requires a trivially copyable T, supply a custom serializer");
+	/// If non-zero elements are copied as raw bytes and write()/read() are not used.
+	enum { raw = 1 };
+	bool write(std::ostream& os, const T& v) const
+	{
+		char buf[snapshot_packed<T>::size];
+		snapshot_packed<T>::pack(buf, v);
+		return (bool)os.write(buf, sizeof(buf));
+	}
+	bool read(std::istream& is, T& v) const
+	{
+		char buf[snapshot_packed<T>::size];
+		if (!is.read(buf, sizeof(buf)))
+			return false;
+		snapshot_packed<T>::unpack(buf, v);
+		return true;
+	}
+};
+
+/// @cond
+template<class T, class Serializer>
+inline bool snapshot_write_header(std::ostream& os, snapshot_header::kind_type kind, size_t count, size_t domain, const Serializer&)
+{
+	snapshot_header h;
+	std::memset(&h, 0, sizeof(h));
+	h.magic = snapshot_header::MAGIC;
+	h.version = snapshot_header::VERSION;
+	h.byte_order = snapshot_header::ORDER_MARK;
+	h.kind = kind;
+	h.value_size = Serializer::raw? uint32_t(snapshot_packed<T>::size): 0;
+	h.count = count;
+	h.domain = domain;
+	return (bool)os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+// Get the bytes left in a seekable stream, or -1 if the stream can not seek.
+inline int64_t snapshot_remaining(std::istream& is)
+{
+	std::streampos pos = is.tellg();
+	if (pos == std::streampos(-1))
+	{
+		is.clear();
+		return -1;
+	}
+	is.seekg(0, std::ios::end);
+	std::streampos end = is.tellg();
+	is.clear();
+	is.seekg(pos);
+	return (end == std::streampos(-1) || end < pos)? -1: int64_t(end - pos);
+}
+
+// Read and validate a header. The count must be addressable by an unsigned
+// index, no more than the domain, and for raw elements fit in the stream.
+template<class T, class Serializer>
+inline bool snapshot_read_header(std::istream& is, snapshot_header::kind_type kind, snapshot_header& h, const Serializer&)
+{
+	if (!is.read(reinterpret_cast<char*>(&h), sizeof(h)))
+		return false;
+	if (h.magic != snapshot_header::MAGIC ||
+		h.version != snapshot_header::VERSION ||
+		h.byte_order != snapshot_header::ORDER_MARK ||
+		h.kind != uint32_t(kind) ||
+		h.value_size != (Serializer::raw? uint32_t(snapshot_packed<T>::size): 0))
+		return false;
+	if (h.count > 0xFFFFFFFFULL || h.count > h.domain)
+		return false;
+	if (Serializer::raw)
+	{
+		int64_t remaining = snapshot_remaining(is);
+		if (remaining >= 0 && h.count*h.value_size > uint64_t(remaining))
+			return false;
+	}
+	return true;
+}
+
+enum {
+	// Elements are packed through a buffer of this size when they have padding
+	SNAPSHOT_BUFFER = 4096,
+	// The number of elements a vector grows by while loading
+	SNAPSHOT_RUN = 65536
+};
+
+template<class T, class Serializer>
+inline bool snapshot_write(std::ostream& os, const T* p, size_t n, const Serializer&, std::true_type)
+{
+	typedef snapshot_packed<T> packed;
+	if (sizeof(T) == size_t(packed::size))
+		return (bool)os.write(reinterpret_cast<const char*>(p), std::streamsize(n*sizeof(T)));
+	char buf[size_t(SNAPSHOT_BUFFER) > size_t(packed::size)? size_t(SNAPSHOT_BUFFER): size_t(packed::size)];
+	const size_t batch = sizeof(buf)/packed::size;
+	for (const T* pend=p+n; p!=pend; )
+	{
+		char* q = buf;
+		for (size_t i=0; i<batch && p!=pend; ++i, ++p)
+			q = packed::pack(q, *p);
+		if (!os.write(buf, q - buf))
+			return false;
+	}
+	return true;
+}
+
+template<class T, class Serializer>
+inline bool snapshot_write(std::ostream& os, const T* p, size_t n, const Serializer& s, std::false_type)
+{
+	for (const T* pend=p+n; p!=pend; ++p)
+	{
+		if (!s.write(os, *p))
+			return false;
+	}
+	return true;
+}
+
+// Write n contiguous elements
+template<class T, class Serializer>
+inline bool snapshot_write(std::ostream& os, const T* p, size_t n, const Serializer& s)
+{
+	return snapshot_write(os, p, n, s, std::integral_constant<bool, Serializer::raw != 0>());
+}
+
+template<class T, class Serializer>
+inline bool snapshot_read(std::istream& is, T* p, size_t n, const Serializer&, std::true_type)
+{
+	typedef snapshot_packed<T> packed;
+	if (sizeof(T) == size_t(packed::size))
+		return (bool)is.read(reinterpret_cast<char*>(p), std::streamsize(n*sizeof(T)));
+	char buf[size_t(SNAPSHOT_BUFFER) > size_t(packed::size)? size_t(SNAPSHOT_BUFFER): size_t(packed::size)];
+	const size_t batch = sizeof(buf)/packed::size;
+	for (T* pend=p+n; p!=pend; )
+	{
+		size_t k = std::min<size_t>(batch, size_t(pend - p));
+		if (!is.read(buf, std::streamsize(k*packed::size)))
+			return false;
+		const char* q = buf;
+		for (; k != 0; --k, ++p)
+			q = packed::unpack(q, *p);
+	}
+	return true;
+}
+
+template<class T, class Serializer>
+inline bool snapshot_read(std::istream& is, T* p, size_t n, const Serializer& s, std::false_type)
+{
+	for (T* pend=p+n; p!=pend; ++p)
+	{
+		if (!s.read(is, *p))
+			return false;
+	}
+	return true;
+}
+
+// Read n contiguous elements into constructed storage
+template<class T, class Serializer>
+inline bool snapshot_read(std::istream& is, T* p, size_t n, const Serializer& s)
+{
+	return snapshot_read(is, p, n, s, std::integral_constant<bool, Serializer::raw != 0>());
+}
+
+// Append count elements to the empty vector v in runs of at most run elements.
+// Storage grows only as elements arrive, so a corrupt count fails at the end of
+// the stream instead of allocating up front. For a block_vector run must be the
+// block size so each run is contiguous. On failure v is empty.
+template<class Vector, class Serializer>
+inline bool snapshot_read_all(std::istream& is, Vector& v, uint64_t count, size_t run, const Serializer& s)
+{
+	while (v.size() < count)
+	{
+		size_t at = v.size();
+		size_t n = size_t(std::min<uint64_t>(run, count - at));
+		v.resize(at + n);
+		if (!snapshot_read(is, &v[at], n, s))
+		{
+			v.clear();
+			return false;
+		}
+	}
+	return true;
+}
+/// @endcond
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(SNAPSHOT_4A8E2F17_C63D_4B90_9E15_D07B3A6C2E58)
@@ -0,0 +1,403 @@
+#ifndef STABLE_VECTOR_MAP_9D4B1E63_0F2A_4C8E_A1B7_6E35D8C0F214
+#define STABLE_VECTOR_MAP_9D4B1E63_0F2A_4C8E_A1B7_6E35D8C0F214
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	An integer keyed map whose elements never move once inserted.
+/// @author Paul Glendenning
+/// @date
+
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include "property.hpp"
+#include "bitmap.hpp"
+#include "block_vector.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// @cond
+template<class Map, class Value>
+class stable_vector_map_iterator: public std::iterator<std::forward_iterator_tag, Value>
+{
+	template<class K, class T, class A, unsigned BS> friend class stable_vector_map;
+	template<class M, class V> friend class stable_vector_map_iterator;
+
+	Map*	_owner;
+	size_t	_pos;
+public:
+	stable_vector_map_iterator(): _owner(0), _pos(~size_t(0)) { }
+	stable_vector_map_iterator(Map* owner, size_t pos): _owner(owner), _pos(pos) { }
+	// Allow iterator to const_iterator conversion
+	template<class M, class V>
+	stable_vector_map_iterator(const stable_vector_map_iterator<M,V>& other): _owner(other._owner), _pos(other._pos) { }
+
+	/// The slot index of the element, stable until compact() is called.
+	size_t slot() const { return _pos; }
+
+	Value& operator * () const { return _owner->_set[_pos]; }
+	Value* operator -> () const { return &_owner->_set[_pos]; }
+	stable_vector_map_iterator& operator ++ ()
+	{
+		_pos = _owner->_live.find_next(_pos+1);
+		return *this;
+	}
+	stable_vector_map_iterator operator ++ (int)
+	{
+		stable_vector_map_iterator prev(*this);
+		++*this;
+		return prev;
+	}
+	bool operator == (const stable_vector_map_iterator& other) const { return _pos == other._pos; }
+	bool operator != (const stable_vector_map_iterator& other) const { return _pos != other._pos; }
+};
+/// @endcond
+
+/// A stable_vector_map is a sibling of unordered_vector_map where erase() never
+/// moves another element. Erased slots become holes, tracked by a live bitmap
+/// and reused by later inserts through a free list. Storage is a block_vector
+/// so growing never moves elements either. Pointers and references to values
+/// therefore remain valid until the element is erased or compact() is called.
+///
+/// Iteration skips holes by scanning the live bitmap a word at a time, so the
+/// cost is O(slots/64 + size()). Call compact() to remove the holes when the
+/// map has become fragmented.
+///
+/// @param Key		The key type. Must be an integer type.
+/// @param T		The mapped type. Must be default constructible, holes hold a
+///					default value.
+/// @param Alloc	Allocator function.
+/// @param BS		The storage block size. Must be a power of 2.
+/// @remarks The space complexity is O(N), where N is the maximum key. The time
+/// complexity for insert, erase, and find is O(1).
+template<class Key, class T, class Alloc=std::allocator<std::pair<Key,T> >, unsigned BS=1024>
+class stable_vector_map
+{
+public:
+	typedef Key					key_type;
+	typedef T					mapped_type;
+	typedef std::pair<Key,T>    value_type;
+	typedef block_vector<value_type, Alloc, BS> vector_type;
+	typedef bitmap<uint64_t, typename Alloc::template rebind<uint64_t>::other> bitmap_type;
+	typedef stable_vector_map_iterator<stable_vector_map, value_type>				iterator;
+	typedef stable_vector_map_iterator<const stable_vector_map, const value_type>	const_iterator;
+	typedef bool (*key_compare)(const key_type& a, const key_type& b);
+	typedef bool (*value_compare)(const value_type& a, const value_type& b);
+private:
+	/// @cond
+	template<class M, class V> friend class stable_vector_map_iterator;
+
+	// The map uses uninitialized storage so avoid std::vector here.
+	unsigned*					_map;
+	size_t						_mapSize;
+	// The data storage, includes holes.
+	vector_type					_set;
+	// Bit i is set if slot i of _set holds an element.
+	bitmap_type					_live;
+	// Slots of _set which are holes.
+	std::vector<unsigned, typename Alloc::template rebind<unsigned>::other> _free;
+	typename Alloc::template rebind<unsigned>::other _mapAllocator;
+
+	void resize_map(size_t newSize)
+	{
+		if (newSize > _mapSize)
+		{
+			if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
+			_map = _mapAllocator.allocate(newSize);
+			_mapSize = newSize;
+			remap();
+		}
+	}
+
+	void remap()
+	{
+		for (size_t i=_live.find_next(0); i!=bitmap_type::npos; i=_live.find_next(i+1))
+			_map[_set[i].first] = unsigned(i);
+	}
+
+	// Get the slot of key, or npos if it is not in the map
+	size_t slot_of(key_type key) const
+	{
+		if (size_t(key) < _mapSize)
+		{
+			unsigned x = _map[key];
+			if (x < _set.size() && _live.test(x) && _set[x].first == key)
+				return x;
+		}
+		return bitmap_type::npos;
+	}
+
+	void erase_slot(size_t x)
+	{
+		_set[x].second = mapped_type();
+		_live.reset(x);
+		if (x == _set.size()-1)
+			_set.pop_back();
+		else
+			_free.push_back(unsigned(x));
+	}
+
+	static bool vcompare(const value_type& a, const value_type& b)
+	{
+		return a.first < b.first;
+	}
+
+	static bool kcompare(const key_type& a, const key_type& b)
+	{
+		return a < b;
+	}
+	/// @endcond
+
+public:
+	/// Create a stable_vector_map with capacity for keys in [0,N).
+	stable_vector_map(size_t N=0): _map(0), _mapSize(0) { reserve(N); }
+
+	/// Copy a stable_vector_map. Slots, and holes, are preserved.
+	stable_vector_map(const stable_vector_map& other):
+		_map(0), _mapSize(0), _set(other._set), _live(other._live), _free(other._free)
+	{
+		resize_map(other._mapSize);
+	}
+
+	/// Destructor.
+	~stable_vector_map()
+	{
+		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
+	}
+
+	/// Assignment
+	stable_vector_map& operator = (const stable_vector_map& other)
+	{
+		if (this == &other) return *this;
+		_set = other._set;
+		_live = other._live;
+		_free = other._free;
+		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
+		_mapSize = 0;
+		_map = 0;
+		resize_map(other._mapSize);
+		return *this;
+	}
+
+	/// Reserve index space for keys in [0,capacity).
+	void reserve(size_t capacity) { resize_map(capacity); }
+
+	/// Get the index capacity.
+	size_t capacity() const { return _mapSize; }
+
+	/// @{
+	/// STL container properties
+	size_t size() const { return _set.size() - _free.size(); }
+
+	/// Get the heap memory held by the map. Holes are counted as slack, the
+	/// free list as overhead.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _set.memory_usage();
+		info.payload = size()*sizeof(value_type);
+		info.slack += _free.size()*sizeof(value_type);
+		info.index = _mapSize*sizeof(unsigned) + _live.memory_usage().index;
+		info.overhead += _free.capacity()*sizeof(unsigned);
+		return info;
+	}
+	bool empty() const { return size() == 0; }
+	/// @}
+
+	/// Get the number of storage slots, including holes.
+	size_t slots() const { return _set.size(); }
+
+	/// Get the number of holes left by erase().
+	size_t holes() const { return _free.size(); }
+
+	/// STL pattern compatible with std::map<>. Remove all items.
+	/// @remarks Complexity O(slots()).
+	void clear()
+	{
+		_set.clear();
+		_live.clear();
+		_free.clear();
+	}
+
+	/// STL pattern compatible with std::map<>
+	void swap(stable_vector_map& other)
+	{
+		std::swap(_map, other._map);
+		std::swap(_mapSize, other._mapSize);
+		_set.swap(other._set);
+		_live.swap(other._live);
+		_free.swap(other._free);
+	}
+
+	/// @{
+	/// STL iterator patterns compatible with std::map<>. Iteration is in slot
+	/// order and skips holes.
+	iterator begin() { return iterator(this, _live.find_next(0)); }
+	iterator end() { return iterator(this, bitmap_type::npos); }
+	const_iterator begin() const { return const_iterator(this, _live.find_next(0)); }
+	const_iterator end() const { return const_iterator(this, bitmap_type::npos); }
+	/// @}
+
+	/// STL pattern compatible with std::map<>. If key does not exist the
+	/// mapped value is constructed from args in the most recent hole, or
+	/// appended if there are no holes.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> try_emplace(key_type key, Args&&... args)
+	{
+		size_t x = slot_of(key);
+		if (x != bitmap_type::npos)
+			return std::make_pair(iterator(this, x), false);
+		if (!(size_t(key) < _mapSize))
+			reserve(std::max<size_t>(size_t(key)+1, 2*_mapSize));
+		if (_free.empty())
+		{
+			_set.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+				std::forward_as_tuple(std::forward<Args>(args)...));
+			x = _set.size()-1;
+			if (_live.size() <= x)
+				_live.resize(std::max<size_t>(x+1, 2*_live.size()));
+		}
+		else
+		{
+			x = _free.back();
+			_set[x].second = mapped_type(std::forward<Args>(args)...);
+			_set[x].first = key;
+			_free.pop_back();
+		}
+		_live.set(x);
+		_map[key] = unsigned(x);
+		return std::make_pair(iterator(this, x), true);
+	}
+
+	/// STL pattern compatible with std::map<>
+	/// @remarks Complexity O(1).
+	std::pair<iterator, bool> insert(const value_type& p)
+	{
+		return try_emplace(p.first, p.second);
+	}
+
+	/// STL pattern compatible with std::map<>
+	/// @remarks Complexity O(1).
+	std::pair<iterator, bool> insert(value_type&& p)
+	{
+		return try_emplace(p.first, std::move(p.second));
+	}
+
+	/// STL pattern compatible with std::map<>
+	/// @remarks Complexity O(1).
+	mapped_type& operator [](key_type key)
+	{
+		return try_emplace(key).first->second;
+	}
+
+	/// STL pattern compatible with std::map<>
+	/// @remarks Complexity O(1).
+	iterator find(key_type key)
+	{
+		return iterator(this, slot_of(key));
+	}
+
+	/// STL pattern compatible with std::map<>
+	/// @remarks Complexity O(1).
+	const_iterator find(key_type key) const
+	{
+		return const_iterator(this, slot_of(key));
+	}
+
+	/// Check if an element exists in the map.
+	/// @remarks Complexity O(1).
+	bool test(key_type key) const
+	{
+		return slot_of(key) != bitmap_type::npos;
+	}
+
+	/// STL pattern compatible with std::map<>. No other element moves.
+	/// @remarks Complexity O(1).
+	void erase(iterator it)
+	{
+		if (it != end())
+			erase_slot(it._pos);
+	}
+
+	/// STL pattern compatible with std::map<>. No other element moves.
+	/// @return	The number of elements erased.
+	/// @remarks Complexity O(1).
+	size_t erase(key_type key)
+	{
+		size_t x = slot_of(key);
+		if (x == bitmap_type::npos)
+			return 0;
+		erase_slot(x);
+		return 1;
+	}
+
+	/// Remove all holes by moving elements from the end of storage into them.
+	/// Invalidates iterators, pointers and references to moved elements.
+	/// @remarks Complexity O(holes() + slots()/64).
+	void compact()
+	{
+		size_t n = size();
+		for (size_t i=0; i<_free.size(); ++i)
+		{
+			size_t hole = _free[i];
+			if (hole >= n) continue;
+			// Find the last live element, trimming trailing holes.
+			while (!_live.test(_set.size()-1))
+				_set.pop_back();
+			size_t last = _set.size()-1;
+			std::swap(_set[hole], _set[last]);
+			_map[_set[hole].first] = unsigned(hole);
+			_live.set(hole);
+			_live.reset(last);
+			_set.pop_back();
+		}
+		_set.resize(n);
+		_free.clear();
+	}
+
+	/// Required for XTL set operations
+	static key_compare key_comp() { return kcompare; }
+	static value_compare value_comp() { return vcompare; }
+};
+
+/// Stable vector map traits
+template<class K, class T, class A, unsigned BS>
+struct container_traits<stable_vector_map<K,T,A,BS> >: public __map_traits<stable_vector_map<K,T,A,BS> >
+{
+	typedef associative_container_tag category;
+	UNSUPPORTED_PROPERTY(allow_duplicate_keys);
+	UNSUPPORTED_PROPERTY(sorted);
+	typedef key_properties<K> key_props;
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(STABLE_VECTOR_MAP_9D4B1E63_0F2A_4C8E_A1B7_6E35D8C0F214)
@@ -0,0 +1,251 @@
+#ifndef TIMER_WHEEL_2F7B8E14_6C3A_4D92_B5E1_90A4C7D3F628
+#define TIMER_WHEEL_2F7B8E14_6C3A_4D92_B5E1_90A4C7D3F628
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/// @file
+/// @brief	A hierarchical timer wheel.
+/// @author Paul Glendenning
+/// @date
+
+#include <cstdint>
+#include "property.hpp"
+#include "bitmagic.hpp"
+#include "intrusive_list.hpp"
+
+namespace xtl {
+// ----------------------------------------------------------------------------
+
+/// A timer_wheel timer.
+template<class T>
+struct timer_wheel_entry
+{
+	/// The expiry tick, set by timer_wheel::schedule().
+	uint64_t	expires;
+	/// User data.
+	T			value;
+	timer_wheel_entry(): expires(0), value() { }
+};
+
+/// A hierarchical timer wheel. Each level has SLOTS slots and each slot is an
+/// intrusive_list of timers, so schedule and cancel are O(1) and never
+/// allocate. A level 0 slot covers one tick, a level 1 slot covers SLOTS ticks,
+/// and so on. Timers due beyond the top level wait on an overflow list.
+///
+/// A timer is placed in the lowest level whose slot holds its expiry tick,
+/// that is the level where the expiry and the current tick first agree in all
+/// higher digits. When the current tick enters a higher level slot, its timers
+/// cascade down to lower levels. Each level keeps a 64 bit occupancy word, so
+/// advance() jumps straight to the next occupied slot with a trailing zero
+/// count rather than visiting every tick.
+///
+/// Timers are intrusive_list_unlinkable_item objects, allocated by the caller,
+/// and are cancelled by unlinking them from whichever slot holds them.
+///
+/// @code
+/// typedef timer_wheel<connection*> wheel_type;
+/// wheel_type wheel;
+/// wheel_type::timer_type& t = conn->timeout;
+/// t.reference_cast().value = conn;
+/// wheel.schedule(&t, wheel.now() + 30000);
+/// ...
+/// wheel_type::cancel(&t);
+/// ...
+/// wheel.advance(clock_ms(), [](wheel_type::timer_type& t) { close(t.reference_cast().value); });
+/// @endcode
+///
+/// @param T		User data held by each timer.
+/// @param Levels	The number of levels. Timers up to SLOTS^Levels ticks ahead
+///					are placed directly, later ones wait on the overflow list.
+/// @remarks schedule() and cancel() are O(1). advance() is O(expired timers +
+/// cascaded timers + occupied slots passed).
+template<class T, unsigned Levels=4>
+class timer_wheel
+{
+public:
+	typedef timer_wheel_entry<T>							value_type;
+	typedef intrusive_list_unlinkable_item<value_type>		timer_type;
+	typedef intrusive_list<value_type, timer_type>			list_type;
+	enum {
+		SLOT_BITS = 6,
+		SLOTS = 1 << SLOT_BITS,
+		SLOT_MASK = SLOTS - 1,
+		LEVELS = Levels
+	};
+private:
+	/// @cond
+	typedef bitmagic<uint64_t> magic;
+	static_assert(Levels > 0 && Levels*SLOT_BITS < 64, "timer_wheel Levels out of range");
+
+	list_type	_slots[Levels][SLOTS];
+	// Bit i is set if slot i may hold timers. Cleared when a slot is emptied.
+	uint64_t	_occupied[Levels];
+	list_type	_overflow;
+	uint64_t	_now;
+
+	timer_wheel(const timer_wheel&);
+	timer_wheel& operator = (const timer_wheel&);
+
+	static unsigned shift_of(unsigned level) { return SLOT_BITS*level; }
+
+	void place(timer_type* t)
+	{
+		uint64_t e = t->reference_cast().expires;
+		uint64_t diff = e ^ _now;
+		for (unsigned l=0; l<Levels; ++l)
+		{
+			if ((diff >> shift_of(l+1)) == 0)
+			{
+				unsigned slot = unsigned(e >> shift_of(l)) & SLOT_MASK;
+				_slots[l][slot].push_back(t);
+				_occupied[l] |= uint64_t(1) << slot;
+				return;
+			}
+		}
+		_overflow.push_back(t);
+	}
+
+	// Move all timers in lst to a temporary list then place them again.
+	void replace(list_type& lst)
+	{
+		list_type tmp;
+		while (!lst.empty())
+		{
+			timer_type* t = lst.head();
+			t->unlink();
+			tmp.push_back(t);
+		}
+		while (!tmp.empty())
+		{
+			timer_type* t = tmp.head();
+			t->unlink();
+			place(t);
+		}
+	}
+
+	// The next tick after _now where a slot must be fired or cascaded.
+	uint64_t next_tick() const
+	{
+		for (unsigned l=0; l<Levels; ++l)
+		{
+			unsigned idx = unsigned(_now >> shift_of(l)) & SLOT_MASK;
+			uint64_t bits = (idx == SLOT_MASK)? 0: _occupied[l] & (~uint64_t(0) << (idx+1));
+			if (bits)
+				return ((_now >> shift_of(l+1)) << shift_of(l+1)) | (uint64_t(magic::tzc(bits)) << shift_of(l));
+		}
+		if (!_overflow.empty())
+			return ((_now >> shift_of(Levels)) + 1) << shift_of(Levels);
+		return ~uint64_t(0);
+	}
+
+	// Cascade the slots which start at _now, highest level first.
+	void cascade()
+	{
+		if ((_now & ((uint64_t(1) << shift_of(Levels)) - 1)) == 0)
+			replace(_overflow);
+		for (unsigned l=Levels-1; l>0; --l)
+		{
+			if ((_now & ((uint64_t(1) << shift_of(l)) - 1)) != 0)
+				continue;
+			unsigned slot = unsigned(_now >> shift_of(l)) & SLOT_MASK;
+			_occupied[l] &= ~(uint64_t(1) << slot);
+			replace(_slots[l][slot]);
+		}
+	}
+	/// @endcond
+
+public:
+	/// Create a wheel.
+	/// @param now	The current tick.
+	explicit timer_wheel(uint64_t now=0): _now(now)
+	{
+		for (unsigned l=0; l<Levels; ++l)
+			_occupied[l] = 0;
+	}
+
+	/// Get the current tick.
+	uint64_t now() const { return _now; }
+
+	/// Schedule a timer. If t is already scheduled it is moved.
+	/// @param	t		The timer.
+	/// @param	expires	The expiry tick. Ticks not after now() expire on the next tick.
+	/// @remarks Complexity O(1).
+	void schedule(timer_type* t, uint64_t expires)
+	{
+		if (t->is_linked()) t->unlink();
+		t->reference_cast().expires = (expires > _now)? expires: _now+1;
+		place(t);
+	}
+
+	/// Cancel a timer. Safe if the timer is not scheduled.
+	/// @remarks Complexity O(1).
+	static void cancel(timer_type* t) { t->unlink(); }
+
+	/// Check if a timer is scheduled.
+	static bool pending(const timer_type* t) { return t->is_linked(); }
+
+	/// Advance the current tick to now and call f(timer_type&) for each timer
+	/// which expires, in tick order. Timers are unlinked before f is called so
+	/// f may schedule them again.
+	/// @return	The number of timers which expired.
+	template<class F>
+	size_t advance(uint64_t now, F f)
+	{
+		size_t count = 0;
+		while (_now < now)
+		{
+			uint64_t t = next_tick();
+			if (t > now)
+			{
+				_now = now;
+				break;
+			}
+			_now = t;
+			cascade();
+			unsigned slot = unsigned(_now) & SLOT_MASK;
+			list_type& lst = _slots[0][slot];
+			_occupied[0] &= ~(uint64_t(1) << slot);
+			while (!lst.empty())
+			{
+				timer_type* timer = lst.head();
+				timer->unlink();
+				++count;
+				f(*timer);
+			}
+		}
+		return count;
+	}
+
+	/// Get a lower bound of the tick when the next timer expires. Cancelled
+	/// timers are not accounted for, so the result may be early but never late.
+	/// @return	The tick or ~0 if no timers are scheduled.
+	uint64_t next_expiry() const { return next_tick(); }
+};
+
+// ----------------------------------------------------------------------------
+// END OF DECLARATIONS
+//
+}		// namespace xtl
+#endif	// defined(TIMER_WHEEL_2F7B8E14_6C3A_4D92_B5E1_90A4C7D3F628)
@@ -33,35 +33,44 @@
 
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <utility>
 #include "property.hpp"
 #include "block_vector.hpp"
+#include "memory.hpp"
+#include "search.hpp"
+#include "snapshot.hpp"
+#include "parallel.hpp"
+#include "radix_sort.hpp"
 
 namespace xtl {
 // ----------------------------------------------------------------------------
 
-template<class BV>
+/// @cond
+// An index block. The block memory is only allocated when a key in the block's
+// range is inserted. The live count is only valid when generation matches the
+// owning map's generation, otherwise the block has no live keys.
 struct unordered_block_vector_map_entry
 {
-	typename BV::allocator_type::template rebind<unsigned>::other allocator;
 	unsigned* ptr;
-	unordered_block_vector_map_entry()
-	{
-		ptr = allocator.allocate(BV::METRICS.BLOCK_SIZE);
-	}
-	unordered_block_vector_map_entry(const unordered_block_vector_map_entry& other)
-	{
-		ptr = allocator.allocate(BV::METRICS.BLOCK_SIZE);
-		memcpy(ptr, other.ptr, BV::METRICS.BLOCK_SIZE*sizeof(*ptr));
-	}
-	~unordered_block_vector_map_entry()
-	{
-		allocator.deallocate(ptr, BV::METRICS.BLOCK_SIZE);
-	}
-	void swap(unordered_block_vector_map_entry& other)
-	{
-		std::swap(other.ptr, ptr);
-	}
+	size_t generation;
+	unsigned live;
+	unordered_block_vector_map_entry(): ptr(0), generation(0), live(0) { }
+};
+
+// A directory page of N index blocks. Pages are allocated when a key in their
+// range is inserted and released when their last index block is released.
+template<unsigned N>
+struct unordered_block_vector_map_page
+{
+	unordered_block_vector_map_entry entries[N];
+	// The number of allocated index blocks
+	unsigned used;
+	unordered_block_vector_map_page(): used(0) { }
 };
+/// @endcond
 
 /// A unordered_block_vector_map is an unordered map using two block vectors,
 /// one for the key value pair and one to determine if the map entry exists.
@@ -72,8 +81,16 @@ struct unordered_block_vector_map_entry
 /// @param Alloc	The value type allocator.
 /// @param BS		The block vector size.
 /// @see	 unordered_block_vector_map<>.
-/// @remarks The space complexity is O(N), where N is the maximum key. The time 
-/// complexity for insert, erase, and find is O(1).
+/// The index is a two level radix directory. The top level is a vector of
+/// directory pages, each page holds PAGE_SIZE index blocks, and each index block
+/// holds one unsigned for each of BLOCK_SIZE keys. Pages and index blocks are
+/// only allocated for key ranges which are touched by insert, and are released
+/// when their last key is erased. Sparse clusters of keys in a large key space
+/// therefore only cost one top level pointer per PAGE_SIZE*BLOCK_SIZE keys.
+///
+/// @remarks The space complexity is O(K/(PAGE_SIZE*BLOCK_SIZE) + B*BLOCK_SIZE),
+/// where K is the maximum key and B is the number of index blocks with live keys.
+/// The time complexity for insert, erase, and find is O(1).
 template<class Key, class T, class Alloc=std::allocator<std::pair<Key,T> >, unsigned BS=1024>
 class unordered_block_vector_map
 {
@@ -95,30 +112,151 @@ public:
 private:
 
 	/// @cond
-	// Each map uses uninitialized storage of unsigned[] so avoid std::vector here.
-    std::vector<unordered_block_vector_map_entry<vector_type> > _maps;
+	enum
+	{
+		PAGE_SHIFT = 9,
+		PAGE_SIZE = 1 << PAGE_SHIFT,
+		PAGE_MASK = PAGE_SIZE - 1
+	};
+	typedef unordered_block_vector_map_entry entry_type;
+	typedef unordered_block_vector_map_page<PAGE_SIZE> page_type;
+	// The top level directory. Null entries are unallocated pages.
+	std::vector<page_type*, typename Alloc::template rebind<page_type*>::other> _pages;
 	// The data storage set
     vector_type	_set;
-
-	/// Return the number of elements in _maps.
-	size_t map_capacity() const
+	// Incremented by clear(). Index blocks with an older generation have no live keys.
+	size_t _generation;
+	// The number of allocated index blocks
+	size_t _blocks;
+	// Each index block uses uninitialized storage of unsigned[] so avoid std::vector here.
+	typename Alloc::template rebind<unsigned>::other _blockAllocator;
+	typename Alloc::template rebind<page_type>::other _pageAllocator;
+#if XTL_CONTAINER_STATS != 0
+	mutable container_stats_counters _stats;
+#endif
+
+	// Get the index block of a key, or null if its page is not allocated
+	entry_type* map_entry(size_t idx)
 	{
-		return _maps.size() * vector_type::METRICS.BLOCK_SIZE;
+		size_t block = idx >> vector_type::METRICS.BLOCK_SHIFT;
+		size_t page = block >> PAGE_SHIFT;
+		return (page < _pages.size() && _pages[page])? &_pages[page]->entries[block & PAGE_MASK]: 0;
 	}
 
-	void map_reserve(size_t newSize)
+	const entry_type* map_entry(size_t idx) const
 	{
-		_maps.resize((newSize+vector_type::METRICS.BLOCK_SIZE-1)/vector_type::METRICS.BLOCK_SIZE);
+		size_t block = idx >> vector_type::METRICS.BLOCK_SHIFT;
+		size_t page = block >> PAGE_SHIFT;
+		return (page < _pages.size() && _pages[page])? &_pages[page]->entries[block & PAGE_MASK]: 0;
 	}
 
+	// Get the index slot of a key which is known to be in the map
 	unsigned& map_item(size_t idx)
 	{
-		return _maps[idx >> vector_type::METRICS.BLOCK_SHIFT].ptr[idx & vector_type::METRICS.BLOCK_MASK];
+		return map_entry(idx)->ptr[idx & vector_type::METRICS.BLOCK_MASK];
 	}
 
 	const unsigned& map_item(size_t idx) const
 	{
-		return _maps[idx >> vector_type::METRICS.BLOCK_SHIFT].ptr[idx & vector_type::METRICS.BLOCK_MASK];
+		return map_entry(idx)->ptr[idx & vector_type::METRICS.BLOCK_MASK];
+	}
+
+	// Get the index slot of a key, or null if its index block is not allocated
+	const unsigned* map_find(size_t idx) const
+	{
+		const entry_type* e = map_entry(idx);
+		return (e && e->ptr)? e->ptr + (idx & vector_type::METRICS.BLOCK_MASK): 0;
+	}
+
+	// Get the index block of a key about to be inserted, allocating it if required
+	entry_type& map_block(size_t idx)
+	{
+		size_t block = idx >> vector_type::METRICS.BLOCK_SHIFT;
+		size_t page = block >> PAGE_SHIFT;
+		if (page >= _pages.size())
+			_pages.resize(page+1, 0);
+		if (!_pages[page])
+		{
+			_pages[page] = _pageAllocator.allocate(1);
+			::new ((void*)_pages[page]) page_type();
+		}
+		page_type& pg = *_pages[page];
+		entry_type& e = pg.entries[block & PAGE_MASK];
+		if (!e.ptr)
+		{
+			XTL_STATS_COUNT(remaps);
+			e.ptr = _blockAllocator.allocate(vector_type::METRICS.BLOCK_SIZE);
+			++pg.used;
+			++_blocks;
+		}
+		if (e.generation != _generation)
+		{
+			e.generation = _generation;
+			e.live = 0;
+		}
+		return e;
+	}
+
+	// Release an index block, and its page if it was the last block in the page
+	void map_free(size_t page, entry_type& e)
+	{
+		_blockAllocator.deallocate(e.ptr, vector_type::METRICS.BLOCK_SIZE);
+		e.ptr = 0;
+		e.live = 0;
+		--_blocks;
+		if (--_pages[page]->used == 0)
+		{
+			_pages[page]->~page_type();
+			_pageAllocator.deallocate(_pages[page], 1);
+			_pages[page] = 0;
+		}
+	}
+
+	// Update the live count when a key is removed from the map, and release the
+	// index block when it has no live keys.
+	void map_release(size_t idx)
+	{
+		entry_type& e = *map_entry(idx);
+		XTL_ITERATOR_ASSERT1(e.generation == _generation && e.live > 0);
+		if (--e.live == 0)
+			map_free((idx >> vector_type::METRICS.BLOCK_SHIFT) >> PAGE_SHIFT, e);
+	}
+
+	// Release all pages and index blocks
+	void map_clear()
+	{
+		for (size_t i=0; i<_pages.size(); ++i)
+		{
+			if (!_pages[i]) continue;
+			for (unsigned j=0; j<PAGE_SIZE && _pages[i]; ++j)
+			{
+				if (_pages[i]->entries[j].ptr)
+					map_free(i, _pages[i]->entries[j]);
+			}
+		}
+		_pages.clear();
+	}
+
+	// Deep copy the index of other
+	void map_copy(const unordered_block_vector_map& other)
+	{
+		_pages.resize(other._pages.size(), 0);
+		for (size_t i=0; i<other._pages.size(); ++i)
+		{
+			if (!other._pages[i]) continue;
+			_pages[i] = _pageAllocator.allocate(1);
+			::new ((void*)_pages[i]) page_type(*other._pages[i]);
+			for (unsigned j=0; j<PAGE_SIZE; ++j)
+			{
+				entry_type& e = _pages[i]->entries[j];
+				if (e.ptr)
+				{
+					e.ptr = _blockAllocator.allocate(vector_type::METRICS.BLOCK_SIZE);
+					memcpy(e.ptr, other._pages[i]->entries[j].ptr, vector_type::METRICS.BLOCK_SIZE*sizeof(unsigned));
+				}
+			}
+		}
+		_blocks = other._blocks;
 	}
 
 	static bool vcompare(const value_type& a, const value_type& b)
@@ -130,6 +268,21 @@ private:
 	{
 		return a < b;
 	}
+
+	static key_type key_of(const value_type& v)
+	{
+		return v.first;
+	}
+
+	static bool vkcompare(const value_type& a, const key_type& k)
+	{
+		return a.first < k;
+	}
+
+	static bool kvcompare(const key_type& k, const value_type& a)
+	{
+		return k < a.first;
+	}
 	/// @endcond
 
 	/// If the vector map is passed to modifying algorithms such as std::sort() or 
@@ -148,46 +301,121 @@ private:
 
 public:
 	/// Create a unordered_block_vector_map with capacity for N elements.
-	unordered_block_vector_map() { }
+	unordered_block_vector_map(): _generation(0), _blocks(0) { }
 	unordered_block_vector_map(const unordered_block_vector_map& other):
-		_maps(other._maps), _set(other._set) { }
+		_set(other._set), _generation(other._generation), _blocks(0)
+	{
+		map_copy(other);
+	}
+	~unordered_block_vector_map() { map_clear(); }
 
 	/// Assignment
 	unordered_block_vector_map& operator = (const unordered_block_vector_map& other)
 	{
-		_set = other._set;
-		_maps = other._maps;
+		if (this != &other)
+		{
+			_set = other._set;
+			map_clear();
+			map_copy(other);
+			_generation = other._generation;
+		}
 		return *this;
 	}
 
-	/// Reserve disabled for block vectors
-	void reserve(size_t capacity) { }
+	/// Reserve the page directory for keys less than capacity. Index blocks
+	/// and their pages are still allocated on first use.
+	void reserve(size_t capacity)
+	{
+		if (capacity == 0) return;
+		size_t block = (capacity - 1) >> vector_type::METRICS.BLOCK_SHIFT;
+		_pages.reserve((block >> PAGE_SHIFT) + 1);
+	}
 
 	/// Get the current storage reserve size.
-	/// @return  The storage reserve size.
-	size_t capacity() const { return map_capacity(); }
+	/// @return  The number of keys covered by allocated index blocks.
+	size_t capacity() const { return _blocks * vector_type::METRICS.BLOCK_SIZE; }
 
 	/// STL pattern compatible with std::map<>
 	/// @return  The number of elements in the map.
     size_t size() const { return _set.size(); }
 
+	/// Get the hot path event counts.
+	/// @see XTL_CONTAINER_STATS
+	container_stats stats() const
+	{
+#if XTL_CONTAINER_STATS != 0
+		container_stats s = _stats.load();
+		s.grows += _set.stats().grows;
+		return s;
+#else
+		return container_stats();
+#endif
+	}
+
+	/// Zero the hot path event counts.
+	void reset_stats()
+	{
+#if XTL_CONTAINER_STATS != 0
+		_stats.store(container_stats());
+		_set.reset_stats();
+#endif
+	}
+
+	/// Get the heap memory held by the map. The index is the allocated index
+	/// blocks, overhead includes the directory and its pages.
+	/// @remarks Complexity O(K/(PAGE_SIZE*BLOCK_SIZE)) where K is the maximum key.
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _set.memory_usage();
+		info.index = _blocks*vector_type::METRICS.BLOCK_SIZE*sizeof(unsigned);
+		info.overhead += _pages.capacity()*sizeof(page_type*);
+		for (size_t i=0; i<_pages.size(); ++i)
+			if (_pages[i]) info.overhead += sizeof(page_type);
+		return info;
+	}
+
 	/// STL pattern compatible with std::map<>
 	/// @return  True is the map is empty.
 	bool empty() const { return _set.empty(); }
 
 	/// STL pattern compatible with std::map<>. All items in the map will be destroyed.
-	/// @remarks Complexity O(N), where N=size().
+	/// The index is not touched. Stale index slots are rejected because they fail
+	/// validation against the data storage set, and stale live counts are rejected
+	/// because the index block's generation no longer matches the map generation.
+	/// @remarks Complexity O(N), where N=size(), for value destruction. The index
+	/// reset is O(1).
     void clear()
     {
         _set.clear();
-		//_maps.clear();
+		++_generation;
     }
 
+	/// Release index blocks with no live keys, which after a clear() is all of
+	/// them, and trim the top level directory.
+	/// @remarks Complexity O(P*PAGE_SIZE), where P is the number of allocated pages.
+	void shrink_to_fit()
+	{
+		for (size_t i=0; i<_pages.size(); ++i)
+		{
+			for (unsigned j=0; j<PAGE_SIZE && _pages[i]; ++j)
+			{
+				entry_type& e = _pages[i]->entries[j];
+				if (e.ptr && (e.generation != _generation || e.live == 0))
+					map_free(i, e);
+			}
+		}
+		while (!_pages.empty() && !_pages.back())
+			_pages.pop_back();
+		_pages.shrink_to_fit();
+	}
+
 	/// STL pattern compatible with std::map<>
 	void swap(unordered_block_vector_map& other)
 	{
-		_maps.swap(other._maps);
+		_pages.swap(other._pages);
 		_set.swap(other._set);
+		std::swap(_generation, other._generation);
+		std::swap(_blocks, other._blocks);
 	}
 
 	/// @{
@@ -206,23 +434,64 @@ public:
 	/// @remarks Complexity O(1).
 	std::pair<iterator, bool> insert(const value_type& p)
 	{
-		if (p.first < (key_type)map_capacity())
-		{
-			unsigned& x = map_item(p.first);
-			if (x >= _set.size() || _set[x].first != p.first)
-			{
-				x = _set.size();
-				_set.push_back(p);
-				return std::make_pair(_set.end()-1, true);
-			}
-			return std::make_pair(_set.begin()+x, false);
-		}
-		map_reserve(p.first+1);
+		const unsigned* x = map_find(p.first);
+		if (x && *x < _set.size() && _set[*x].first == p.first)
+			return std::make_pair(_set.begin()+*x, false);
+		++map_block(p.first).live;
 		map_item(p.first) = _set.size();
 		_set.push_back(p);
 		return std::make_pair(_set.end()-1, true);
 	}
 
+	/// STL pattern compatible with std::map<>. The value is moved into the map.
+	/// @remarks Complexity O(1).
+	std::pair<iterator, bool> insert(value_type&& p)
+	{
+		return try_emplace(p.first, std::move(p.second));
+	}
+
+	/// STL pattern compatible with std::map<>. The element is constructed from
+	/// args before the key is known, use try_emplace() to avoid constructing a
+	/// value when the key exists.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> emplace(Args&&... args)
+	{
+		value_type v(std::forward<Args>(args)...);
+		return try_emplace(v.first, std::move(v.second));
+	}
+
+	/// STL pattern compatible with std::map<>. If key does not exist the
+	/// mapped value is constructed in place from args, otherwise args are not
+	/// touched.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> try_emplace(key_type key, Args&&... args)
+	{
+		const unsigned* x = map_find(key);
+		if (x && *x < _set.size() && _set[*x].first == key)
+			return std::make_pair(_set.begin()+*x, false);
+		entry_type& e = map_block(key);
+		_set.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Args>(args)...));
+		++e.live;
+		e.ptr[size_t(key) & vector_type::METRICS.BLOCK_MASK] = _set.size()-1;
+		return std::make_pair(_set.end()-1, true);
+	}
+
+	/// STL pattern compatible with std::map<>. Assign obj to the mapped value
+	/// if key exists, otherwise construct it in place from obj.
+	/// @return	The element and true if inserted, false if assigned.
+	/// @remarks Complexity O(1).
+	template<class M>
+	std::pair<iterator, bool> insert_or_assign(key_type key, M&& obj)
+	{
+		std::pair<iterator, bool> r = try_emplace(key, std::forward<M>(obj));
+		if (!r.second)
+			r.first->second = std::forward<M>(obj);
+		return r;
+	}
+
 	/// STL pattern compatible with std::map<>
 	/// @remarks Iterator is ignored
 	/// @see insert(const value_type& p)
@@ -248,42 +517,27 @@ public:
 	/// @remarks Complexity O(1)
     mapped_type& operator [](key_type key) 
     { 
-		if (key < (key_type)map_capacity())
-		{
-			unsigned& x = map_item(key);
-			if (x >= _set.size() || _set[x].first != key)
-			{
-				x = _set.size();
-				_set.push_back(std::make_pair(key,mapped_type()));
-				return _set.back().second;
-			}
-			return _set[x].second;
-		}
-		map_reserve(key+1);
-		map_item(key) = _set.size();
-		_set.push_back(std::make_pair(key,mapped_type()));
-		return _set.back().second;
+		return try_emplace(key).first->second;
     }
 
 	/// STL pattern compatible with std::map<>
 	/// @remarks Complexity O(1)
     const mapped_type& operator [](key_type key) const
     { 
-        assert(unsigned(key) < map_capacity());
-		const unsigned& x = map_item(key);
-        assert(x < _set.size() && _set[x].first == key);
-		return _set[x].second;
+		const unsigned* x = map_find(key);
+        assert(x && *x < _set.size() && _set[*x].first == key);
+		return _set[*x].second;
     }
 
 	/// STL pattern compatible with std::map<>
 	/// @remarks Complexity O(1).
 	iterator find(key_type key)
 	{	
-		if (unsigned(key) < map_capacity())
-		{
-			const unsigned& x = map_item(key);
-			return (x < _set.size() && _set[x].first == key)? _set.begin()+x: _set.end();
-		}
+		XTL_STATS_COUNT(finds);
+		const unsigned* x = map_find(key);
+		if (x && *x < _set.size() && _set[*x].first == key)
+			return _set.begin()+*x;
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -291,11 +545,11 @@ public:
 	/// @remarks Complexity O(1).
 	const_iterator find(key_type key) const
 	{
-		if (unsigned(key) < map_capacity())
-		{
-			const unsigned& x = map_item(key);
-			return (x < _set.size() && _set[x].first == key)? _set.begin()+x: _set.end();
-		}
+		XTL_STATS_COUNT(finds);
+		const unsigned* x = map_find(key);
+		if (x && *x < _set.size() && _set[*x].first == key)
+			return _set.begin()+*x;
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -305,9 +559,11 @@ public:
 	{
         if (it != end())
         {
+			map_release(it->first);
             if (it != (end()-1))
             {
 				// Exchange with back to preserve _set contiguity
+				XTL_STATS_COUNT(erase_swaps);
                 map_item( _set.back().first ) = (unsigned)(it - _set.begin());
 				// Don't copy since it may be expensive for value_type.
                 std::swap(*it, _set.back());
@@ -320,21 +576,25 @@ public:
 	/// @remarks Complexity O(|last-first|).
 	void erase(iterator first, iterator last)
 	{
-		using namespace std;
-		ptrdiff_t n = last - first;
 		XTL_ITERATOR_ASSERT1(first <= last);
 		if (first != last)
 		{	
-			// Move down
-			reverse_iterator rfirst(last), rlast(first), rpos(rbegin());
-			for (ptrdiff_t d=last-begin(); rfirst != rlast && rfirst != rend(); ++rfirst, ++rpos)
+			unsigned f = (unsigned)(first - begin());
+			unsigned l = (unsigned)(last - begin());
+			unsigned n = l - f;
+			unsigned sz = (unsigned)_set.size();
+			for (unsigned i=f; i<l; ++i)
+				map_release(_set[i].first);
+			// Move the tail down into the hole to preserve _set contiguity
+			unsigned m = std::min(n, sz - l);
+			for (unsigned k=0; k<m; ++k)
 			{
-				// Exchange with back to preserve _set contiguity
-                map_item( rpos->first ) = (unsigned)--d;
 				// Don't copy since it may be expensive for value_type.
-                std::swap(*rfirst, *rpos);
+				XTL_STATS_COUNT(erase_swaps);
+				std::swap(_set[f+k], _set[sz-1-k]);
+				map_item(_set[f+k].first) = f+k;
 			}
-			_set.resize(_set.size() - n);
+			_set.resize(sz - n);
 		}
 	}
 
@@ -342,20 +602,22 @@ public:
 	/// @remarks Complexity O(1).
     size_t erase(const key_type& key)
     {
-		if (unsigned(key) < map_capacity())
+		const unsigned* p = map_find(key);
+		if (p)
 		{
-			const unsigned& x = map_item(key);
+			unsigned x = *p;
 			if (x < _set.size() && _set[x].first == key)
 			{
+				map_release(key);
 				if (x != (_set.size()-1))
 				{
 					// Exchange with back to preserve _set contiguity
+					XTL_STATS_COUNT(erase_swaps);
 					map_item( _set.back().first ) = x;
 					// Don't copy since it may be expensive for value_type.
 					std::swap(_set[x], _set.back());
 				}
 				_set.pop_back();
-				//map_reserve(_set.size());
 			}
 		}
 		return size();
@@ -365,33 +627,165 @@ public:
 	/// @remarks Complexity O(1).
     bool test(key_type key) const 
 	{ 
-		if (unsigned(key) < map_capacity())
+		const unsigned* x = map_find(key);
+		return (x && *x < _set.size() && _set[*x].first == key);
+	}
+
+	/// Write a binary snapshot. The header is followed by the dense storage
+	/// array in storage order, see snapshot.hpp.
+	/// @param	os	The output stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success.
+	/// @remarks Complexity O(N). Trivially copyable elements are written with one stream write per storage block.
+	template<class Serializer>
+	bool save(std::ostream& os, const Serializer& s) const
+	{
+		size_t domain = 0;
+		for (const_iterator i=_set.begin(); i!=_set.end(); ++i)
+			domain = std::max(domain, size_t(i->first)+1);
+		if (!snapshot_write_header<value_type>(os, snapshot_header::MAP, _set.size(), domain, s))
+			return false;
+		for (size_t i=0; i<_set.size(); i+=vector_type::METRICS.BLOCK_SIZE)
+		{
+			size_t n = std::min<size_t>(vector_type::METRICS.BLOCK_SIZE, _set.size()-i);
+			if (!snapshot_write(os, &_set[unsigned(i)], n, s))
+				return false;
+		}
+		return true;
+	}
+	bool save(std::ostream& os) const { return save(os, snapshot_serializer<value_type>()); }
+
+	/// Replace the contents with a snapshot written by save(). The elements are
+	/// read directly into storage and the index is rebuilt in one pass.
+	/// @param	is	The input stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success. False if the stream is truncated or the snapshot
+	/// is malformed, including out of domain or duplicate keys. On failure the
+	/// map is empty.
+	/// @remarks Complexity O(N).
+	template<class Serializer>
+	bool load(std::istream& is, const Serializer& s)
+	{
+		clear();
+		snapshot_header h;
+		if (!snapshot_read_header<value_type>(is, snapshot_header::MAP, h, s) ||
+			!snapshot_read_all(is, _set, h.count, vector_type::METRICS.BLOCK_SIZE, s))
+			return false;
+		for (iterator i=_set.begin(); i!=_set.end(); ++i)
 		{
-			const unsigned& x = map_item(key);
-			return (x < _set.size() && _set[x].first == key);
+			if (uint64_t(size_t(i->first)) >= h.domain || i->first != key_type(size_t(i->first)))
+			{
+				_set.clear();
+				return false;
+			}
 		}
-		return false;
+		try
+		{
+			unsigned j = 0;
+			for (iterator i=_set.begin(); i!=_set.end(); ++i, ++j)
+			{
+				const unsigned* x = map_find(i->first);
+				if (x && *x < j && _set[*x].first == i->first)
+				{
+					// clear() retires the live counts built so far
+					clear();
+					return false;
+				}
+				++map_block(i->first).live;
+				map_item(i->first) = j;
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			clear();
+			return false;
+		}
+		return true;
 	}
+	bool load(std::istream& is) { return load(is, snapshot_serializer<value_type>()); }
 
 	/// In order to use upper_bound, lower_bound, a sort is required.
+	/// @remarks Complexity O(size()). Keys are integers so a radix sort is used.
 	void sort()
 	{ 
-		std::sort(_set.begin(), _set.end(), vcompare);
+		radix_sort(_set.begin(), _set.end(), key_of);
 		remap();
 	}
 
 	/// @{
-	/// These functions can only be used after a sort
-	iterator upper_bound() { return std::upper_bound(_set.begin(), _set.end(), vcompare); }
-	const_iterator upper_bound() const { return std::upper_bound(_set.begin(), _set.end(), vcompare); }
-	iterator lower_bound() { return std::lower_bound(_set.begin(), _set.end(), vcompare); }
-	const_iterator lower_bound() const { return std::lower_bound(_set.begin(), _set.end(), vcompare); }
+	/// Sort with an execution policy. parallel_policy sorts with
+	/// parallel_radix_sort() and rebuilds the index with remap(parallel_policy).
+	void sort(const sequenced_policy&) { sort(); }
+	void sort(const parallel_policy& policy)
+	{
+		parallel_radix_sort(_set.begin(), _set.end(), key_of, policy.threads);
+		remap(policy);
+	}
+	/// @}
+
+	/// @{
+	/// Rebuild the index with an execution policy. Keys are unique and their
+	/// index blocks already exist, so each thread scatters a chunk of the data
+	/// storage into disjoint index slots.
+	/// @remarks Complexity O(size()) work, O(size()/P) elapsed for P threads.
+	void remap(const sequenced_policy&) { remap(); }
+	void remap(const parallel_policy& policy)
+	{
+		parallel_for_chunks(_set.size(), parallel_chunks(_set.size(), policy.threads),
+			[this](size_t first, size_t last, unsigned) {
+				for (size_t i=first; i<last; ++i)
+					map_item(_set[unsigned(i)].first) = unsigned(i);
+			});
+	}
+	/// @}
+
+	/// @{
+	/// Get the first element whose key is not less than key. Can only be used
+	/// after a sort(). An exact match is resolved with the index, otherwise a
+	/// branch free binary search is made over the sorted data storage.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator lower_bound(key_type key) { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare); }
+	const_iterator lower_bound(key_type key) const { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare); }
+	/// @}
+
+	/// @{
+	/// Get the first element whose key is greater than key. Can only be used
+	/// after a sort().
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator upper_bound(key_type key) { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, kvcompare); }
+	const_iterator upper_bound(key_type key) const { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, kvcompare); }
+	/// @}
+
+	/// @{
+	/// Get the range of elements whose key equals key. Can only be used after
+	/// a sort(). Keys are unique so the range is empty or holds one element.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	std::pair<iterator, iterator> equal_range(key_type key)
+	{
+		if (test(key))
+		{
+			iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare);
+		return std::make_pair(x, x);
+	}
+	std::pair<const_iterator, const_iterator> equal_range(key_type key) const
+	{
+		if (test(key))
+		{
+			const_iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		const_iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare);
+		return std::make_pair(x, x);
+	}
 	/// @}
 };
 
 /// Vector map traits
-template<class K, class T, class A>
-struct container_traits<unordered_block_vector_map<K,T,A> >: public __map_traits<unordered_block_vector_map<K,T,A> >
+template<class K, class T, class A, unsigned BS>
+struct container_traits<unordered_block_vector_map<K,T,A,BS> >: public __map_traits<unordered_block_vector_map<K,T,A,BS> >
 {
 	typedef associative_container_tag category;
 	UNSUPPORTED_PROPERTY(allow_duplicate_keys);
@@ -33,7 +33,15 @@
 
 #include <vector>
 #include <algorithm>
+#include <new>
+#include <tuple>
+#include <utility>
 #include "property.hpp"
+#include "bitmap.hpp"
+#include "search.hpp"
+#include "snapshot.hpp"
+#include "parallel.hpp"
+#include "radix_sort.hpp"
 
 namespace xtl {
 // ----------------------------------------------------------------------------
@@ -48,6 +56,9 @@ namespace xtl {
 /// @param T		The value type.
 /// @param Alloc	The value type allocator.
 /// @see	 unordered_vector_set<>.
+/// An optional presence bitmap, enabled with set_ordered(), provides iteration
+/// in key order without sorting the data storage set.
+///
 /// @remarks The space complexity is O(N), where N is the maximum key. The time 
 /// complexity for insert, erase, and find is O(1).
 template<class Key, class T, class Alloc=std::allocator<std::pair<Key,T> > >
@@ -69,6 +80,9 @@ public:
 	typedef typename std::reverse_iterator<const_iterator> const_reverse_iterator;
 	typedef bool (*key_compare)(const key_type& a, const key_type& b);
 	typedef bool (*value_compare)(const value_type& a, const value_type& b);
+	typedef bitmap<uint64_t, typename Alloc::template rebind<uint64_t>::other> bitmap_type;
+	typedef bitmap_ordered_iterator<unordered_vector_map, iterator>				ordered_iterator;
+	typedef bitmap_ordered_iterator<const unordered_vector_map, const_iterator>	const_ordered_iterator;
 private:
 
 	/// @cond
@@ -80,11 +94,19 @@ private:
     vector_type					_set;
 	// The allocator
 	typename Alloc::template rebind<unsigned>::other _mapAllocator;
+	// The presence bitmap, only maintained when _ordered is set.
+	bitmap_type					_present;
+	bool						_ordered;
+#if XTL_CONTAINER_STATS != 0
+	mutable container_stats_counters	_stats;
+#endif
 
 	void resize_map(size_t newSize)
 	{
 		if (newSize > _mapSize)
 		{
+			XTL_STATS_COUNT(remaps);
+			if (_ordered) _present.resize(newSize);
 			if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 			_map = _mapAllocator.allocate(newSize);
 			_mapSize = newSize;
@@ -103,6 +125,21 @@ private:
 	{
 		return a < b;
 	}
+
+	static key_type key_of(const value_type& v)
+	{
+		return v.first;
+	}
+
+	static bool vkcompare(const value_type& a, const key_type& k)
+	{
+		return a.first < k;
+	}
+
+	static bool kvcompare(const key_type& k, const value_type& a)
+	{
+		return k < a.first;
+	}
 	/// @endcond
 
 	/// If the vector map is passed to modifying algorithms such as std::sort() or 
@@ -121,17 +158,26 @@ private:
 
 public:
 	/// Create a unordered_vector_map with capacity for N elements.
-	unordered_vector_map(size_t N=0): _map(0), _mapSize(0) { reserve(N); }
+	unordered_vector_map(size_t N=0): _map(0), _mapSize(0), _ordered(false) { reserve(N); }
 	unordered_vector_map(const unordered_vector_map& other):
-		_map(0), _mapSize(0), _set(other._set)
+		_map(0), _mapSize(0), _set(other._set), _present(other._present), _ordered(other._ordered)
 	{
-		resize_map(other._set.capacity());
+		resize_map(other._mapSize);
+	}
+
+	/// Destructor.
+	~unordered_vector_map()
+	{
+		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 	}
 
 	/// Assignment
 	unordered_vector_map& operator = (const unordered_vector_map& other)
 	{
+		if (this == &other) return *this;
 		_set = other._set;
+		_present = other._present;
+		_ordered = other._ordered;
 		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 		_mapSize = 0;
 		_map = 0;
@@ -144,6 +190,7 @@ public:
 	/// elements.
 	void reserve(size_t capacity)
 	{
+		XTL_STATS_COUNT_IF(capacity > _set.capacity(), grows);
 		_set.reserve(capacity);
 		resize_map(capacity);
 	}
@@ -157,23 +204,90 @@ public:
 	/// @return  The number of elements in the map.
     size_t size() const { return _set.size(); }
 
+	/// Get the hot path event counts.
+	/// @see XTL_CONTAINER_STATS
+	container_stats stats() const
+	{
+#if XTL_CONTAINER_STATS != 0
+		return _stats.load();
+#else
+		return container_stats();
+#endif
+	}
+
+	/// Zero the hot path event counts.
+	void reset_stats()
+	{
+#if XTL_CONTAINER_STATS != 0
+		_stats.store(container_stats());
+#endif
+	}
+
+	/// Get the heap memory held by the map. The index is the sparse key map
+	/// plus the presence bitmap when ordered.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _present.memory_usage();
+		info.index += _mapSize*sizeof(unsigned);
+		info.payload = _set.size()*sizeof(value_type);
+		info.slack = (_set.capacity() - _set.size())*sizeof(value_type);
+		return info;
+	}
+
 	/// STL pattern compatible with std::map<>
 	/// @return  True is the map is empty.
 	bool empty() const { return _set.empty(); }
 
 	/// STL pattern compatible with std::map<>. All items in the map will be destroyed.
-	/// @remarks Complexity O(N), where N=size().
+	/// The index is not touched. Stale index slots are rejected because they fail
+	/// validation against the data storage set, so there is nothing to reset.
+	/// @remarks Complexity O(N), where N=size(), for value destruction. The index
+	/// reset is O(1).
     void clear()
     {
+		if (_ordered)
+		{
+			if (_set.size() < _present.words())
+			{
+				for (iterator i=_set.begin(); i!=_set.end(); ++i)
+					_present.reset(i->first);
+			}
+			else
+				_present.clear();
+		}
         _set.clear();
     }
 
+	/// Reduce the index to cover only the largest live key, and release unused
+	/// data storage capacity.
+	/// @remarks Complexity O(size()). If the index shrinks it is reallocated and
+	/// remapped.
+	void shrink_to_fit()
+	{
+		size_t newSize = 0;
+		for (const_iterator i=_set.begin(); i!=_set.end(); ++i)
+			newSize = std::max(newSize, size_t(i->first)+1);
+		_set.shrink_to_fit();
+		if (newSize < _mapSize)
+		{
+			_mapAllocator.deallocate(_map, _mapSize);
+			_map = newSize? _mapAllocator.allocate(newSize): 0;
+			_mapSize = newSize;
+			remap();
+			if (_ordered) _present.resize(newSize);
+		}
+		_present.shrink_to_fit();
+	}
+
 	/// STL pattern compatible with std::map<>
 	void swap(unordered_vector_map& other)
 	{
 		std::swap(_map, other._map);
 		std::swap(_mapSize, other._mapSize);
 		_set.swap(other._set);
+		_present.swap(other._present);
+		std::swap(_ordered, other._ordered);
 	}
 
 	/// @{
@@ -200,7 +314,9 @@ public:
 			if (x >= _set.size() || _set[x].first != p.first)
 			{
 				x = _set.size();
+				XTL_STATS_COUNT_IF(_set.size() == _set.capacity(), grows);
 				_set.push_back(p);
+				if (_ordered) _present.set(p.first);
 				return std::make_pair(_set.end()-1, true);
 			}
 			return std::make_pair(_set.begin()+x, false);
@@ -208,9 +324,61 @@ public:
 		reserve(p.first+1);
 		_map[p.first] = _set.size();
 		_set.push_back(p);
+		if (_ordered) _present.set(p.first);
 		return std::make_pair(_set.end()-1, true);
 	}
 
+	/// STL pattern compatible with std::map<>. The value is moved into the map.
+	/// @remarks Complexity O(1).
+	std::pair<iterator, bool> insert(value_type&& p)
+	{
+		return try_emplace(p.first, std::move(p.second));
+	}
+
+	/// STL pattern compatible with std::map<>. The element is constructed from
+	/// args before the key is known, use try_emplace() to avoid constructing a
+	/// value when the key exists.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> emplace(Args&&... args)
+	{
+		value_type v(std::forward<Args>(args)...);
+		return try_emplace(v.first, std::move(v.second));
+	}
+
+	/// STL pattern compatible with std::map<>. If key does not exist the
+	/// mapped value is constructed in place from args, otherwise args are not
+	/// touched.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> try_emplace(key_type key, Args&&... args)
+	{
+		if (!(key < (key_type)_mapSize))
+			reserve(key+1);
+		unsigned& x = _map[key];
+		if (x < _set.size() && _set[x].first == key)
+			return std::make_pair(_set.begin()+x, false);
+		XTL_STATS_COUNT_IF(_set.size() == _set.capacity(), grows);
+		_set.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Args>(args)...));
+		x = _set.size()-1;
+		if (_ordered) _present.set(key);
+		return std::make_pair(_set.end()-1, true);
+	}
+
+	/// STL pattern compatible with std::map<>. Assign obj to the mapped value
+	/// if key exists, otherwise construct it in place from obj.
+	/// @return	The element and true if inserted, false if assigned.
+	/// @remarks Complexity O(1).
+	template<class M>
+	std::pair<iterator, bool> insert_or_assign(key_type key, M&& obj)
+	{
+		std::pair<iterator, bool> r = try_emplace(key, std::forward<M>(obj));
+		if (!r.second)
+			r.first->second = std::forward<M>(obj);
+		return r;
+	}
+
 	/// STL pattern compatible with std::map<>
 	/// @remarks Iterator is ignored
 	/// @see insert(const value_type& p)
@@ -236,21 +404,7 @@ public:
 	/// @remarks Complexity O(1)
     mapped_type& operator [](key_type key) 
     { 
-		if (key < (key_type)_mapSize)
-		{
-			unsigned& x = _map[key];
-			if (x >= _set.size() || _set[x].first != key)
-			{
-				x = _set.size();
-				_set.push_back(std::make_pair(key,mapped_type()));
-				return _set.back().second;
-			}
-			return _set[x].second;
-		}
-		reserve(key+1);
-		_map[key] = _set.size();
-		_set.push_back(std::make_pair(key,mapped_type()));
-		return _set.back().second;
+		return try_emplace(key).first->second;
     }
 
 	/// STL pattern compatible with std::map<>
@@ -268,11 +422,14 @@ public:
 	/// iterator addition.
 	iterator find(key_type key)
 	{	
+		XTL_STATS_COUNT(finds);
 		if (unsigned(key) < _mapSize)
 		{
 			unsigned x = _map[key];
-			return (x < _set.size() && _set[x].first == key)? _set.begin()+x: _set.end();
+			if (x < _set.size() && _set[x].first == key)
+				return _set.begin()+x;
 		}
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -281,11 +438,14 @@ public:
 	/// iterator addition.
 	const_iterator find(key_type key) const
 	{
+		XTL_STATS_COUNT(finds);
 		if (unsigned(key) < _mapSize)
 		{
 			unsigned x = _map[key];
-			return (x < _set.size() && _set[x].first == key)? _set.begin()+x: _set.end();
+			if (x < _set.size() && _set[x].first == key)
+				return _set.begin()+x;
 		}
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -296,9 +456,11 @@ public:
 	{
         if (it != end())
         {
+			if (_ordered) _present.reset(it->first);
             if (it != (end()-1))
             {
 				// Exchange with back to preserve _set contiguity
+				XTL_STATS_COUNT(erase_swaps);
                 _map[ _set.back().first ] = (unsigned)(it - _set.begin());
 				// Don't copy since it may be expensive for value_type.
                 std::swap(*it, _set.back());
@@ -316,11 +478,17 @@ public:
 		XTL_ITERATOR_ASSERT1(first <= last);
 		if (first != last)
 		{	
+			if (_ordered)
+			{
+				for (iterator i=first; i!=last; ++i)
+					_present.reset(i->first);
+			}
 			// Move down
 			reverse_iterator rfirst(last), rlast(first), rpos(rbegin());
 			for (std::ptrdiff_t d=last-begin(); rfirst != rlast && rfirst != rend(); ++rfirst, ++rpos)
 			{
 				// Exchange with back to preserve _set contiguity
+				XTL_STATS_COUNT(erase_swaps);
                 _map[ rpos->first ] = (unsigned)--d;
 				// Don't copy since it may be expensive for value_type.
                 std::swap(*rfirst, *rpos);
@@ -339,9 +507,11 @@ public:
 			unsigned x = _map[key];
 			if (x < _set.size() && _set[x].first == key)
 			{
+				if (_ordered) _present.reset(key);
 				if (x != (_set.size()-1))
 				{
 					// Exchange with back to preserve _set contiguity
+					XTL_STATS_COUNT(erase_swaps);
 					_map[ _set.back().first ] = x;
 					// Don't copy since it may be expensive for value_type.
 					std::swap(_set[x], _set.back());
@@ -365,23 +535,309 @@ public:
 		return false;
 	}
 
+	/// Set union. Insert all elements of other whose key is not in this map.
+	/// @param	other	A map whose value type is convertible to value_type.
+	/// @remarks Complexity O( other.size() ). There are other.size() insert()
+	/// operations.
+	template<class Map>
+	void set_union(const Map& other)
+	{
+		for (typename Map::const_iterator i=other.begin(); i!=other.end(); ++i)
+			insert(*i);
+	}
+
+	/// Set intersection on keys. Remove all elements whose key is not in other.
+	/// @param	other	Any XTL set or map with integer keys.
+	/// @remarks Complexity O( min(size(), other.size()) ). If other is the smaller
+	/// container it is iterated and each key probed with test(), otherwise this map
+	/// is iterated and each key probed with other.test(). Values are swapped, not
+	/// copied.
+	template<class Set>
+	void set_intersect(const Set& other)
+	{
+		if (other.size() < _set.size())
+		{
+			// Rebuild from the smaller container. Probe every key before moving
+			// any element, so a moved from slot can never satisfy a stale _map
+			// entry during the probe.
+			std::vector<unsigned, typename Alloc::template rebind<unsigned>::other> hits;
+			hits.reserve(other.size());
+			for (typename Set::const_iterator i=other.begin(); i!=other.end(); ++i)
+			{
+				iterator x = find(container_traits<Set>::key_from_value(*i));
+				if (x != _set.end())
+					hits.push_back(unsigned(x - _set.begin()));
+			}
+			vector_type keep;
+			keep.reserve(hits.size());
+			for (size_t i=0; i<hits.size(); ++i)
+				keep.push_back(std::move(_set[hits[i]]));
+			_set.swap(keep);
+			remap();
+			if (_ordered)
+			{
+				for (iterator i=keep.begin(); i!=keep.end(); ++i)
+					_present.reset(i->first);
+				for (iterator i=_set.begin(); i!=_set.end(); ++i)
+					_present.set(i->first);
+			}
+		}
+		else
+		{
+			unsigned j = 0;
+			for (unsigned i=0; i<_set.size(); ++i)
+			{
+				if (other.test(_set[i].first))
+				{
+					_map[_set[i].first] = j;
+					if (i != j) std::swap(_set[j], _set[i]);
+					++j;
+				}
+				else if (_ordered)
+					_present.reset(_set[i].first);
+			}
+			_set.resize(j);
+		}
+	}
+
+	/// Set complementation on keys. Remove all elements whose key is in other.
+	/// @param	other	Any XTL set or map with integer keys.
+	/// @remarks Complexity O( min(size(), other.size()) ). If other is the smaller
+	/// container each of its keys is erased, otherwise this map is iterated and
+	/// each key probed with other.test().
+	template<class Set>
+	void set_complement(const Set& other)
+	{
+		if (other.size() < _set.size())
+		{
+			for (typename Set::const_iterator i=other.begin(); i!=other.end(); ++i)
+				erase(container_traits<Set>::key_from_value(*i));
+		}
+		else
+		{
+			unsigned j = 0;
+			for (unsigned i=0; i<_set.size(); ++i)
+			{
+				if (!other.test(_set[i].first))
+				{
+					_map[_set[i].first] = j;
+					if (i != j) std::swap(_set[j], _set[i]);
+					++j;
+				}
+				else if (_ordered)
+					_present.reset(_set[i].first);
+			}
+			_set.resize(j);
+		}
+	}
+
+	/// Enable or disable the ordered view. When enabled a presence bitmap over the
+	/// key domain is maintained by insert() and erase(), which allows iteration in
+	/// key order without sorting.
+	/// @remarks Enabling is O(capacity()/64 + size()). The bitmap costs one bit
+	/// per key in the domain.
+	void set_ordered(bool enable=true)
+	{
+		if (enable && !_ordered)
+		{
+			_present.resize(_mapSize);
+			for (iterator i=_set.begin(); i!=_set.end(); ++i)
+				_present.set(i->first);
+		}
+		else if (!enable)
+		{
+			bitmap_type().swap(_present);
+		}
+		_ordered = enable;
+	}
+
+	/// @return	True if the ordered view is enabled.
+	bool ordered() const { return _ordered; }
+
+	/// The presence bitmap. Only valid when ordered() is true.
+	const bitmap_type& presence() const { return _present; }
+
+	/// @{
+	/// Iterate the elements in key order. Requires ordered() to be true.
+	/// @remarks Iterating a key range [a,b) containing H elements costs O((b-a)/64 + H).
+	ordered_iterator ordered_begin() { XTL_ITERATOR_ASSERT1(_ordered); return ordered_iterator(this, _present.find_next(0)); }
+	ordered_iterator ordered_end() { return ordered_iterator(this, bitmap_type::npos); }
+	const_ordered_iterator ordered_begin() const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(0)); }
+	const_ordered_iterator ordered_end() const { return const_ordered_iterator(this, bitmap_type::npos); }
+	/// @}
+
+	/// @{
+	/// Get the first element in key order whose key is not less than key.
+	/// Requires ordered() to be true.
+	ordered_iterator ordered_lower_bound(key_type key) { XTL_ITERATOR_ASSERT1(_ordered); return ordered_iterator(this, _present.find_next(size_t(key))); }
+	const_ordered_iterator ordered_lower_bound(key_type key) const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(size_t(key))); }
+	/// @} @{
+	/// Get the first element in key order whose key is greater than key.
+	/// Requires ordered() to be true.
+	ordered_iterator ordered_upper_bound(key_type key) { XTL_ITERATOR_ASSERT1(_ordered); return ordered_iterator(this, _present.find_next(size_t(key)+1)); }
+	const_ordered_iterator ordered_upper_bound(key_type key) const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(size_t(key)+1)); }
+	/// @} @{
+	/// Get the elements in key order whose keys are in the range [first,last).
+	/// Requires ordered() to be true.
+	std::pair<ordered_iterator, ordered_iterator> ordered_range(key_type first, key_type last)
+	{
+		return std::make_pair(ordered_lower_bound(first), ordered_lower_bound(last));
+	}
+	std::pair<const_ordered_iterator, const_ordered_iterator> ordered_range(key_type first, key_type last) const
+	{
+		return std::make_pair(ordered_lower_bound(first), ordered_lower_bound(last));
+	}
+	/// @}
+
+	/// Write a binary snapshot. The header is followed by the dense storage
+	/// array in storage order, see snapshot.hpp.
+	/// @param	os	The output stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success.
+	/// @remarks Complexity O(N). Trivially copyable elements are written with a single stream write.
+	template<class Serializer>
+	bool save(std::ostream& os, const Serializer& s) const
+	{
+		return snapshot_write_header<value_type>(os, snapshot_header::MAP, _set.size(), _mapSize, s) &&
+			snapshot_write(os, _set.data(), _set.size(), s);
+	}
+	bool save(std::ostream& os) const { return save(os, snapshot_serializer<value_type>()); }
+
+	/// Replace the contents with a snapshot written by save(). The elements are
+	/// read directly into storage and the index is rebuilt in one pass. The
+	/// index is sized from the keys read, the saved domain only bounds them.
+	/// @param	is	The input stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success. False if the stream is truncated or the snapshot
+	/// is malformed, including out of domain or duplicate keys. On failure the
+	/// map is empty.
+	/// @remarks Complexity O(N).
+	template<class Serializer>
+	bool load(std::istream& is, const Serializer& s)
+	{
+		clear();
+		snapshot_header h;
+		if (!snapshot_read_header<value_type>(is, snapshot_header::MAP, h, s) ||
+			!snapshot_read_all(is, _set, h.count, SNAPSHOT_RUN, s))
+			return false;
+		size_t domain = 0;
+		for (iterator i=_set.begin(); i!=_set.end(); ++i)
+		{
+			if (uint64_t(unsigned(i->first)) >= h.domain || i->first != key_type(unsigned(i->first)))
+			{
+				_set.clear();
+				return false;
+			}
+			domain = std::max(domain, size_t(unsigned(i->first))+1);
+		}
+		try
+		{
+			resize_map(domain);
+		}
+		catch (const std::bad_alloc&)
+		{
+			_set.clear();
+			return false;
+		}
+		unsigned j = 0;
+		for (iterator i=_set.begin(); i!=_set.end(); ++i, ++j)
+		{
+			unsigned x = _map[i->first];
+			if (x < j && _set[x].first == i->first)
+			{
+				_set.clear();
+				return false;
+			}
+			_map[i->first] = j;
+		}
+		if (_ordered)
+		{
+			for (iterator i=_set.begin(); i!=_set.end(); ++i)
+				_present.set(i->first);
+		}
+		return true;
+	}
+	bool load(std::istream& is) { return load(is, snapshot_serializer<value_type>()); }
+
 	/// In order to use upper_bound, lower_bound, or xtl set operations a sort is required.
+	/// @remarks Complexity O(size()). Keys are integers so a radix sort is used.
 	void sort()
 	{ 
-		std::sort(_set.begin(), _set.end(), vcompare);
+		radix_sort(_set.begin(), _set.end(), key_of);
 		remap();
 	}
 
+	/// @{
+	/// Sort with an execution policy. parallel_policy sorts with
+	/// parallel_radix_sort() and rebuilds the index with remap(parallel_policy).
+	void sort(const sequenced_policy&) { sort(); }
+	void sort(const parallel_policy& policy)
+	{
+		parallel_radix_sort(_set.begin(), _set.end(), key_of, policy.threads);
+		remap(policy);
+	}
+	/// @}
+
+	/// @{
+	/// Rebuild the index with an execution policy. Keys are unique so each
+	/// thread scatters a chunk of the data storage into disjoint index slots.
+	/// @remarks Complexity O(size()) work, O(size()/P) elapsed for P threads.
+	void remap(const sequenced_policy&) { remap(); }
+	void remap(const parallel_policy& policy)
+	{
+		parallel_for_chunks(_set.size(), parallel_chunks(_set.size(), policy.threads),
+			[this](size_t first, size_t last, unsigned) {
+				for (size_t i=first; i<last; ++i)
+					_map[_set[i].first] = unsigned(i);
+			});
+	}
+	/// @}
+
 	/// Required for XTL set operations
 	static key_compare key_comp() { return kcompare; }
 	static value_compare value_comp() { return vcompare; }
 
 	/// @{
-	/// These functions can only be used after a sort
-	iterator upper_bound() { return std::upper_bound(_set.begin(), _set.end(), vcompare); }
-	const_iterator upper_bound() const { return std::upper_bound(_set.begin(), _set.end(), vcompare); }
-	iterator lower_bound() { return std::lower_bound(_set.begin(), _set.end(), vcompare); }
-	const_iterator lower_bound() const { return std::lower_bound(_set.begin(), _set.end(), vcompare); }
+	/// Get the first element whose key is not less than key. Can only be used
+	/// after a sort(). An exact match is resolved with the index, otherwise a
+	/// branch free binary search is made over the sorted data storage.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator lower_bound(key_type key) { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare); }
+	const_iterator lower_bound(key_type key) const { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare); }
+	/// @}
+
+	/// @{
+	/// Get the first element whose key is greater than key. Can only be used
+	/// after a sort().
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator upper_bound(key_type key) { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, kvcompare); }
+	const_iterator upper_bound(key_type key) const { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, kvcompare); }
+	/// @}
+
+	/// @{
+	/// Get the range of elements whose key equals key. Can only be used after
+	/// a sort(). Keys are unique so the range is empty or holds one element.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	std::pair<iterator, iterator> equal_range(key_type key)
+	{
+		if (test(key))
+		{
+			iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare);
+		return std::make_pair(x, x);
+	}
+	std::pair<const_iterator, const_iterator> equal_range(key_type key) const
+	{
+		if (test(key))
+		{
+			const_iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		const_iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, vkcompare);
+		return std::make_pair(x, x);
+	}
 	/// @}
 };
 
@@ -33,7 +33,14 @@
 
 #include <vector>
 #include <algorithm>
+#include <new>
+#include <utility>
 #include "property.hpp"
+#include "bitmap.hpp"
+#include "search.hpp"
+#include "snapshot.hpp"
+#include "parallel.hpp"
+#include "radix_sort.hpp"
 
 namespace xtl {
 // ----------------------------------------------------------------------------
@@ -44,6 +51,9 @@ namespace xtl {
 /// models the concept of a uninitialized memory as described in \link uovs_ref1
 /// "[1]" \endlink. The key must be an integer type.
 ///
+/// An optional presence bitmap, enabled with set_ordered(), provides iteration
+/// in key order without sorting the data storage set.
+///
 /// @param T		The key type.
 /// @param Alloc	Allocator function.
 /// @see	 unordered_vector_map<>.
@@ -67,6 +77,9 @@ public:
 	typedef typename std::reverse_iterator<const_iterator> const_reverse_iterator;
 	typedef bool (*key_compare)(const key_type& a, const key_type& b);
 	typedef bool (*value_compare)(const value_type& a, const value_type& b);
+	typedef bitmap<uint64_t, typename Alloc::template rebind<uint64_t>::other> bitmap_type;
+	typedef bitmap_ordered_iterator<const unordered_vector_set, const_iterator>	ordered_iterator;
+	typedef bitmap_ordered_iterator<const unordered_vector_set, const_iterator>	const_ordered_iterator;
 private:
 	/// @cond
 	// The map uses uninitialized storage so avoid std::vector here.
@@ -77,11 +90,19 @@ private:
     vector_type					_set;
 	// The allocator
 	typename Alloc::template rebind<unsigned>::other _mapAllocator;
+	// The presence bitmap, only maintained when _ordered is set.
+	bitmap_type					_present;
+	bool						_ordered;
+#if XTL_CONTAINER_STATS != 0
+	mutable container_stats_counters	_stats;
+#endif
 
 	void resize_map(size_t newSize)
 	{
 		if (newSize > _mapSize)
 		{
+			XTL_STATS_COUNT(remaps);
+			if (_ordered) _present.resize(newSize);
 			if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 			_map = _mapAllocator.allocate(newSize);
 			_mapSize = newSize;
@@ -113,18 +134,27 @@ private:
 
 public:
 	/// Create a unordered_vector_set with capacity for N elements.
-	unordered_vector_set(size_t N=0): _map(0), _mapSize(0) { reserve(N); }
+	unordered_vector_set(size_t N=0): _map(0), _mapSize(0), _ordered(false) { reserve(N); }
 	/// Copy an unordered_vector_set.
 	unordered_vector_set(const unordered_vector_set& other):
-		_map(0), _mapSize(0), _set(other._set)
+		_map(0), _mapSize(0), _set(other._set), _present(other._present), _ordered(other._ordered)
+	{
+		resize_map(other._mapSize);
+	}
+
+	/// Destructor.
+	~unordered_vector_set()
 	{
-		resize_map(other._set.capacity());
+		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 	}
 
 	/// Assignment
 	unordered_vector_set& operator = (const unordered_vector_set& other)
 	{
+		if (this == &other) return *this;
 		_set = other._set;
+		_present = other._present;
+		_ordered = other._ordered;
 		if (_mapSize) _mapAllocator.deallocate(_map, _mapSize);
 		_mapSize = 0;
 		_map = 0;
@@ -136,6 +166,7 @@ public:
 	/// elements.
 	void reserve(size_t capacity)
 	{
+		XTL_STATS_COUNT_IF(capacity > _set.capacity(), grows);
 		_set.reserve(capacity);
 		resize_map(_set.capacity());
 	}
@@ -149,6 +180,37 @@ public:
 	/// @return  The number of elements in the set.
     size_t size() const { return _set.size(); }
 
+	/// Get the hot path event counts.
+	/// @see XTL_CONTAINER_STATS
+	container_stats stats() const
+	{
+#if XTL_CONTAINER_STATS != 0
+		return _stats.load();
+#else
+		return container_stats();
+#endif
+	}
+
+	/// Zero the hot path event counts.
+	void reset_stats()
+	{
+#if XTL_CONTAINER_STATS != 0
+		_stats.store(container_stats());
+#endif
+	}
+
+	/// Get the heap memory held by the set. The index is the sparse key map
+	/// plus the presence bitmap when ordered.
+	/// @remarks Complexity O(1).
+	memory_usage_info memory_usage() const
+	{
+		memory_usage_info info = _present.memory_usage();
+		info.index += _mapSize*sizeof(unsigned);
+		info.payload = _set.size()*sizeof(value_type);
+		info.slack = (_set.capacity() - _set.size())*sizeof(value_type);
+		return info;
+	}
+
 	/// STL pattern compatible with std::set<>
 	/// @return  True if the set is empty.
 	bool empty() const { return _set.empty(); }
@@ -158,6 +220,16 @@ public:
 	/// for integers.
     void clear()
     {
+		if (_ordered)
+		{
+			if (_set.size() < _present.words())
+			{
+				for (iterator i=_set.begin(); i!=_set.end(); ++i)
+					_present.reset(*i);
+			}
+			else
+				_present.clear();
+		}
         _set.clear();
     }
 
@@ -167,6 +239,8 @@ public:
 		std::swap(_map, other._map);
 		std::swap(_mapSize, other._mapSize);
 		_set.swap(other._set);
+		_present.swap(other._present);
+		std::swap(_ordered, other._ordered);
 	}
 
 	/// @{
@@ -193,7 +267,9 @@ public:
 			if (x >= _set.size() || _set[x] != key)
 			{
 				x = _set.size();
+				XTL_STATS_COUNT_IF(_set.size() == _set.capacity(), grows);
 				_set.push_back(key);
+				if (_ordered) _present.set(key);
 				return std::make_pair(_set.end()-1, true);
 			}
 			return std::make_pair(_set.begin()+x, false);
@@ -201,19 +277,40 @@ public:
 		reserve(key+1);
 		_map[key] = _set.size();
 		_set.push_back(key);
+		if (_ordered) _present.set(key);
 		return std::make_pair(_set.end()-1, true);
 	}
 
+	/// STL pattern compatible with std::set<>. The key is constructed from args.
+	/// @remarks Complexity O(1).
+	template<class... Args>
+	std::pair<iterator, bool> emplace(Args&&... args)
+	{
+		return insert(key_type(std::forward<Args>(args)...));
+	}
+
+	/// STL pattern compatible with std::set<>
+	/// @remarks Iterator is ignored
+	template<class... Args>
+	iterator emplace_hint(const_iterator pos, Args&&... args)
+	{
+		(void)pos;
+		return emplace(std::forward<Args>(args)...).first;
+	}
+
 	/// STL pattern compatible with std::set<>
 	/// @remarks Complexity O(1). Worst case performs one test() and one
 	/// iterator addition.
 	iterator find(key_type key)
 	{	
+		XTL_STATS_COUNT(finds);
 		if (unsigned(key) < _mapSize)
 		{
 			unsigned x = _map[key];
-			return (x < _set.size() && _set[x] == key)? _set.begin()+x: _set.end();
+			if (x < _set.size() && _set[x] == key)
+				return _set.begin()+x;
 		}
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -222,11 +319,14 @@ public:
 	/// iterator addition.
 	const_iterator find(key_type key) const
 	{
+		XTL_STATS_COUNT(finds);
 		if (unsigned(key) < _mapSize)
 		{
 			unsigned x = _map[key];
-			return (x < _set.size() && _set[x] == key)? _set.begin()+x: _set.end();
+			if (x < _set.size() && _set[x] == key)
+				return _set.begin()+x;
 		}
+		XTL_STATS_COUNT(find_misses);
 		return _set.end();
 	}
 
@@ -237,9 +337,11 @@ public:
 	{
         if (it != end())
         {
+			if (_ordered) _present.reset(*it);
             if (it != (end()-1))
             {
 				// Exchange with back to preserve _set contiguity
+				XTL_STATS_COUNT(erase_swaps);
                 _map[ _set.back() ] = (unsigned)(it - _set.begin());
                 const_cast<value_type&>(*it) = const_cast<value_type&>(_set.back());
             }
@@ -253,6 +355,11 @@ public:
 	void erase(iterator first, iterator last)
 	{
 		unsigned n = (unsigned)(last - first);
+		if (_ordered)
+		{
+			for (iterator i=first; i!=last; ++i)
+				_present.reset(*i);
+		}
 		if (last != end())
 		{	
 			// Move down
@@ -260,6 +367,7 @@ public:
 			for (std::ptrdiff_t d=last-first; rfirst != rlast && rfirst != rend(); ++rfirst, ++rpos)
 			{
 				// Exchange with back to preserve _set contiguity
+				XTL_STATS_COUNT(erase_swaps);
                 _map[ *rpos ] = (unsigned)--d;
                 const_cast<value_type&>(*rfirst) = const_cast<value_type&>(*rpos);
 			}
@@ -277,9 +385,11 @@ public:
 			unsigned x = _map[key];
 			if (x < _set.size() && _set[x] == key)
 			{
+				if (_ordered) _present.reset(key);
 				if (x != (_set.size()-1))
 				{
 					// Exchange with back to preserve _set contiguity
+					XTL_STATS_COUNT(erase_swaps);
 					_map[ _set.back() ] = x;
 					const_cast<value_type&>(_set[x]) = const_cast<value_type&>(_set.back());
 				}
@@ -302,89 +412,290 @@ public:
 		return false;
 	}
 
-	/// Set intersection. 
-	/// @remarks Complexity O( size() ). Worst case there are size() operations
-	/// of: test(), vector<>.pop_back(), and 2 * assigment.
-	void set_intersect(const unordered_vector_set& other)
+	/// Set union. Insert all keys of other.
+	/// @param	other	Any XTL set or map with integer keys.
+	/// @remarks Complexity O( other.size() ). There are other.size() insert()
+	/// operations.
+	template<class Set>
+	void set_union(const Set& other)
 	{
-		if (!other.empty())
-		{
-			while (!_set.empty() && !other.test(_set.back()))
-				_set.pop_back();
+		for (typename Set::const_iterator i=other.begin(); i!=other.end(); ++i)
+			insert(container_traits<Set>::key_from_value(*i));
+	}
 
-			if (!_set.empty())
+	/// Set intersection. Remove all keys not in other.
+	/// @param	other	Any XTL set or map with integer keys.
+	/// @remarks Complexity O( min(size(), other.size()) ). If other is the smaller
+	/// set it is iterated and each key probed with test(), otherwise this set is
+	/// iterated and each key probed with other.test().
+	template<class Set>
+	void set_intersect(const Set& other)
+	{
+		if (other.size() < _set.size())
+		{
+			// Rebuild from the smaller set
+			vector_type keep;
+			keep.reserve(other.size());
+			for (typename Set::const_iterator i=other.begin(); i!=other.end(); ++i)
 			{
-				reverse_iterator rfirst = _set.rbegin() + 1;
-				reverse_iterator rlast = _set.rend();
-				do
-				{
-					for (; rfirst != rlast && !other.test(*rfirst); ++rfirst)
-					{
-						// Exchange with back to preserve _set contiguity
-						_map[ _set.back() ] = rlast - rfirst;
-						const_cast<value_type&>(*rfirst) = const_cast<value_type&>(_set.back());
-						_set.pop_back();					
-					}
-					for (; rfirst != rlast && other.test(*rfirst); ++rfirst)
-						continue;
-				} while (rfirst != rlast);
+				const value_type& key = container_traits<Set>::key_from_value(*i);
+				if (test(key)) keep.push_back(key);
+			}
+			_set.swap(keep);
+			remap();
+			if (_ordered)
+			{
+				for (iterator i=keep.begin(); i!=keep.end(); ++i)
+					_present.reset(*i);
+				for (iterator i=_set.begin(); i!=_set.end(); ++i)
+					_present.set(*i);
 			}
 		}
 		else
-			clear();
+		{
+			unsigned j = 0;
+			for (unsigned i=0; i<_set.size(); ++i)
+			{
+				if (other.test(_set[i]))
+				{
+					_map[_set[i]] = j;
+					_set[j++] = _set[i];
+				}
+				else if (_ordered)
+					_present.reset(_set[i]);
+			}
+			_set.resize(j);
+		}
 	}
 
-	/// Set complementation.
-	/// @remarks Complexity O( size() ). Worst case there are size() operations
-	/// of: test(), vector<>.pop_back(), and 2*assigment.
-	void set_complement(const unordered_vector_set& other)
+	/// Set complementation. Remove all keys in other.
+	/// @param	other	Any XTL set or map with integer keys.
+	/// @remarks Complexity O( min(size(), other.size()) ). If other is the smaller
+	/// set each of its keys is erased, otherwise this set is iterated and each key
+	/// probed with other.test().
+	template<class Set>
+	void set_complement(const Set& other)
 	{
-		if (!other.empty())
+		if (other.size() < _set.size())
 		{
-			while (!_set.empty() && other.test(_set.back()))
-				_set.pop_back();
-
-			if (!_set.empty())
+			for (typename Set::const_iterator i=other.begin(); i!=other.end(); ++i)
+				erase(container_traits<Set>::key_from_value(*i));
+		}
+		else
+		{
+			unsigned j = 0;
+			for (unsigned i=0; i<_set.size(); ++i)
 			{
-				reverse_iterator rfirst = _set.rbegin() + 1;
-				reverse_iterator rlast = _set.rend();
-				do
+				if (!other.test(_set[i]))
 				{
-					for (; rfirst != rlast && other.test(*rfirst); ++rfirst)
-					{
-						// Exchange with back to preserve _set contiguity
-						_map[ _set.back() ] = rlast - rfirst;
-						const_cast<value_type&>(*rfirst) = const_cast<value_type&>(_set.back());
-						_set.pop_back();					
-					}
-					for (; rfirst != rlast && !other.test(*rfirst); ++rfirst)
-						continue;
-				} while (rfirst != rlast);
+					_map[_set[i]] = j;
+					_set[j++] = _set[i];
+				}
+				else if (_ordered)
+					_present.reset(_set[i]);
 			}
+			_set.resize(j);
 		}
-		else
-			clear();
 	}
 
+	/// Enable or disable the ordered view. When enabled a presence bitmap over the
+	/// key domain is maintained by insert() and erase(), which allows iteration in
+	/// key order without sorting.
+	/// @remarks Enabling is O(capacity()/64 + size()). The bitmap costs one bit
+	/// per key in the domain.
+	void set_ordered(bool enable=true)
+	{
+		if (enable && !_ordered)
+		{
+			_present.resize(_mapSize);
+			for (iterator i=_set.begin(); i!=_set.end(); ++i)
+				_present.set(*i);
+		}
+		else if (!enable)
+		{
+			bitmap_type().swap(_present);
+		}
+		_ordered = enable;
+	}
+
+	/// @return	True if the ordered view is enabled.
+	bool ordered() const { return _ordered; }
+
+	/// The presence bitmap. Only valid when ordered() is true.
+	const bitmap_type& presence() const { return _present; }
+
+	/// @{
+	/// Iterate the keys in order. Requires ordered() to be true.
+	/// @remarks Iterating a key range [a,b) containing H keys costs O((b-a)/64 + H).
+	const_ordered_iterator ordered_begin() const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(0)); }
+	const_ordered_iterator ordered_end() const { return const_ordered_iterator(this, bitmap_type::npos); }
+	/// @}
+
+	/// Get the first key in order which is not less than key. Requires ordered()
+	/// to be true.
+	const_ordered_iterator ordered_lower_bound(key_type key) const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(size_t(key))); }
+
+	/// Get the first key in order which is greater than key. Requires ordered()
+	/// to be true.
+	const_ordered_iterator ordered_upper_bound(key_type key) const { XTL_ITERATOR_ASSERT1(_ordered); return const_ordered_iterator(this, _present.find_next(size_t(key)+1)); }
+
+	/// Get the keys in order which are in the range [first,last). Requires
+	/// ordered() to be true.
+	std::pair<const_ordered_iterator, const_ordered_iterator> ordered_range(key_type first, key_type last) const
+	{
+		return std::make_pair(ordered_lower_bound(first), ordered_lower_bound(last));
+	}
+
+	/// Write a binary snapshot. The header is followed by the dense storage
+	/// array in storage order, see snapshot.hpp.
+	/// @param	os	The output stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success.
+	/// @remarks Complexity O(N). Trivially copyable elements are written with a single stream write.
+	template<class Serializer>
+	bool save(std::ostream& os, const Serializer& s) const
+	{
+		return snapshot_write_header<value_type>(os, snapshot_header::SET, _set.size(), _mapSize, s) &&
+			snapshot_write(os, _set.data(), _set.size(), s);
+	}
+	bool save(std::ostream& os) const { return save(os, snapshot_serializer<value_type>()); }
+
+	/// Replace the contents with a snapshot written by save(). The elements are
+	/// read directly into storage and the index is rebuilt in one pass. The
+	/// index is sized from the keys read, the saved domain only bounds them.
+	/// @param	is	The input stream, opened in binary mode.
+	/// @param	s	The element serializer.
+	/// @return	True on success. False if the stream is truncated or the snapshot
+	/// is malformed, including out of domain or duplicate keys. On failure the
+	/// set is empty.
+	/// @remarks Complexity O(N).
+	template<class Serializer>
+	bool load(std::istream& is, const Serializer& s)
+	{
+		clear();
+		snapshot_header h;
+		if (!snapshot_read_header<value_type>(is, snapshot_header::SET, h, s) ||
+			!snapshot_read_all(is, _set, h.count, SNAPSHOT_RUN, s))
+			return false;
+		size_t domain = 0;
+		for (iterator i=_set.begin(); i!=_set.end(); ++i)
+		{
+			if (uint64_t(unsigned(*i)) >= h.domain || *i != value_type(unsigned(*i)))
+			{
+				_set.clear();
+				return false;
+			}
+			domain = std::max(domain, size_t(unsigned(*i))+1);
+		}
+		try
+		{
+			resize_map(domain);
+		}
+		catch (const std::bad_alloc&)
+		{
+			_set.clear();
+			return false;
+		}
+		unsigned j = 0;
+		for (iterator i=_set.begin(); i!=_set.end(); ++i, ++j)
+		{
+			unsigned x = _map[*i];
+			if (x < j && _set[x] == *i)
+			{
+				_set.clear();
+				return false;
+			}
+			_map[*i] = j;
+		}
+		if (_ordered)
+		{
+			for (iterator i=_set.begin(); i!=_set.end(); ++i)
+				_present.set(*i);
+		}
+		return true;
+	}
+	bool load(std::istream& is) { return load(is, snapshot_serializer<value_type>()); }
 
 	/// In order to use upper_bound, lower_bound, sort is required.
     /// A sort is not required for the set_xxxx operations.
+	/// @remarks Complexity O(size()). Keys are integers so a radix sort is used.
 	void sort()
 	{ 
-		std::sort(_set.begin(), _set.end(), compare);
+		radix_sort(_set.begin(), _set.end());
 		remap();
 	}
 
+	/// @{
+	/// Sort with an execution policy. parallel_policy sorts with
+	/// parallel_radix_sort() and rebuilds the index with remap(parallel_policy).
+	void sort(const sequenced_policy&) { sort(); }
+	void sort(const parallel_policy& policy)
+	{
+		parallel_radix_sort(_set.begin(), _set.end(), radix_identity<value_type>(), policy.threads);
+		remap(policy);
+	}
+	/// @}
+
+	/// @{
+	/// Rebuild the index with an execution policy. Keys are unique so each
+	/// thread scatters a chunk of the data storage into disjoint index slots.
+	/// @remarks Complexity O(size()) work, O(size()/P) elapsed for P threads.
+	void remap(const sequenced_policy&) { remap(); }
+	void remap(const parallel_policy& policy)
+	{
+		parallel_for_chunks(_set.size(), parallel_chunks(_set.size(), policy.threads),
+			[this](size_t first, size_t last, unsigned) {
+				for (size_t i=first; i<last; ++i)
+					_map[_set[i]] = unsigned(i);
+			});
+	}
+	/// @}
+
 	/// Required for XTL set operations
 	static key_compare key_comp() { return compare; }
 	static value_compare value_comp() { return compare; }
 
 	/// @{
-	/// These functions can only be used after a sort
-	iterator upper_bound() { return std::upper_bound(_set.begin(), _set.end(), compare); }
-	const_iterator upper_bound() const { return std::upper_bound(_set.begin(), _set.end(), compare); }
-	iterator lower_bound() { return std::lower_bound(_set.begin(), _set.end(), compare); }
-	const_iterator lower_bound() const { return std::lower_bound(_set.begin(), _set.end(), compare); }
+	/// Get the first element whose key is not less than key. Can only be used
+	/// after a sort(). An exact match is resolved with the index, otherwise a
+	/// branch free binary search is made over the sorted data storage.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator lower_bound(key_type key) { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, compare); }
+	const_iterator lower_bound(key_type key) const { return test(key)? find(key): branchless_lower_bound(_set.begin(), _set.end(), key, compare); }
+	/// @}
+
+	/// @{
+	/// Get the first element whose key is greater than key. Can only be used
+	/// after a sort().
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	iterator upper_bound(key_type key) { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, compare); }
+	const_iterator upper_bound(key_type key) const { return test(key)? find(key)+1: branchless_upper_bound(_set.begin(), _set.end(), key, compare); }
+	/// @}
+
+	/// @{
+	/// Get the range of elements whose key equals key. Can only be used after
+	/// a sort(). Keys are unique so the range is empty or holds one element.
+	/// @remarks Complexity O(1) if key exists, otherwise O(log N).
+	std::pair<iterator, iterator> equal_range(key_type key)
+	{
+		if (test(key))
+		{
+			iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, compare);
+		return std::make_pair(x, x);
+	}
+	std::pair<const_iterator, const_iterator> equal_range(key_type key) const
+	{
+		if (test(key))
+		{
+			const_iterator x = find(key);
+			return std::make_pair(x, x+1);
+		}
+		const_iterator x = branchless_lower_bound(_set.begin(), _set.end(), key, compare);
+		return std::make_pair(x, x);
+	}
 	/// @}
 };
 
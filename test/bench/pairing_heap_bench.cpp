@@ -0,0 +1,146 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// Deadline queue benchmark for pairing_heap against std::priority_queue.
+// Each round pushes a deadline, cancels one in four and pops the earliest.
+// std::priority_queue cannot erase, so cancelled entries are skipped lazily
+// when they reach the top. Usage: pairing_heap_bench [queue-size] [ops]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include <xtl/pairing_heap.hpp>
+
+using namespace xtl;
+
+namespace {
+// ----------------------------------------------------------------------------
+
+struct timer: public pairing_heap_node
+{
+	unsigned	when;
+	bool operator < (const timer& other) const { return when < other.when; }
+};
+
+struct entry
+{
+	unsigned	when;
+	unsigned	id;
+	bool operator < (const entry& other) const { return when > other.when; }
+};
+
+inline unsigned xorshift(unsigned& x)
+{
+	x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+	return x;
+}
+
+double run_pairing(unsigned size, unsigned ops)
+{
+	std::vector<timer> timers(size);
+	pairing_heap<timer> heap;
+	unsigned x = 2463534242U;
+	unsigned now = 0;
+	for (unsigned i=0; i<size; ++i)
+	{
+		timers[i].when = xorshift(x) & 0xFFFF;
+		heap.push(&timers[i]);
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned i=0; i<ops; ++i)
+	{
+		timer& t = heap.top();
+		heap.pop();
+		now = t.when;
+		t.when = now + (xorshift(x) & 0xFFFF);
+		heap.push(&t);
+		if ((x & 3) == 0)
+		{
+			timer& c = timers[xorshift(x) % size];
+			heap.erase(&c);
+			c.when = now + (x & 0xFFFF);
+			heap.push(&c);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return ops / elapsed.count() / 1e6;
+}
+
+double run_priority_queue(unsigned size, unsigned ops)
+{
+	std::vector<unsigned> generation(size);
+	std::priority_queue<entry> heap;
+	unsigned x = 2463534242U;
+	unsigned now = 0;
+	for (unsigned i=0; i<size; ++i)
+	{
+		entry e = { xorshift(x) & 0xFFFF, i };
+		heap.push(e);
+	}
+	// Pack the generation into the upper id bits to detect cancelled entries
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned i=0; i<ops; ++i)
+	{
+		entry e = heap.top();
+		heap.pop();
+		unsigned id = e.id & 0xFFFFFF;
+		if ((e.id >> 24) != (generation[id] & 0xFF))
+		{
+			--i;
+			continue;
+		}
+		now = e.when;
+		e.when = now + (xorshift(x) & 0xFFFF);
+		heap.push(e);
+		if ((x & 3) == 0)
+		{
+			unsigned c = xorshift(x) % size;
+			++generation[c];
+			entry n = { now + (x & 0xFFFF), c | ((generation[c] & 0xFF) << 24) };
+			heap.push(n);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return ops / elapsed.count() / 1e6;
+}
+
+// ----------------------------------------------------------------------------
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned maxSize = argc > 1 ? (unsigned)std::atoi(argv[1]) : 1 << 20;
+	unsigned ops = argc > 2 ? (unsigned)std::atoi(argv[2]) : 1000000;
+	if (maxSize > (1U << 24)) maxSize = 1U << 24;
+	std::printf("%10s %20s %20s\n", "size", "pairing Mops/s", "priority_queue Mops/s");
+	for (unsigned n=1024; n<=maxSize; n *= 4)
+	{
+		double p = run_pairing(n, ops);
+		double q = run_priority_queue(n, ops);
+		std::printf("%10u %20.2f %20.2f\n", n, p, q);
+	}
+	return 0;
+}
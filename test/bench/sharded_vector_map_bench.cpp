@@ -0,0 +1,110 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Scaling benchmark for sharded_vector_map against a single mutex around an
+// unordered_vector_map. Usage: sharded_vector_map_bench [max-threads] [ops]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <xtl/sharded_vector_map.hpp>
+
+using namespace xtl;
+
+namespace {
+// ----------------------------------------------------------------------------
+
+const unsigned KEYS = 1 << 20;
+
+struct global_lock_map
+{
+	std::mutex lock;
+	unordered_vector_map<unsigned,unsigned> map;
+
+	global_lock_map() { map.reserve(KEYS); }
+	void assign(unsigned key, unsigned value)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		map[key] = value;
+	}
+	bool find(unsigned key, unsigned& value)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		unordered_vector_map<unsigned,unsigned>::iterator it = map.find(key);
+		if (it == map.end()) return false;
+		value = it->second;
+		return true;
+	}
+};
+
+// 75% reads, 25% writes over a uniformly random key
+template<class Map>
+double run(Map& map, unsigned nthreads, unsigned ops)
+{
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned t=0; t<nthreads; ++t)
+	{
+		threads.push_back(std::thread([&map, t, ops]() {
+			unsigned x = 2463534242U + t;
+			unsigned v;
+			for (unsigned i=0; i<ops; ++i)
+			{
+				x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+				unsigned key = x & (KEYS - 1);
+				if ((x >> 28) < 4)
+					map.assign(key, i);
+				else
+					map.find(key, v);
+			}
+		}));
+	}
+	for (unsigned t=0; t<nthreads; ++t)
+		threads[t].join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return double(nthreads) * ops / elapsed.count() / 1e6;
+}
+
+// ----------------------------------------------------------------------------
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned maxThreads = argc > 1 ? (unsigned)std::atoi(argv[1]) : 64;
+	unsigned ops = argc > 2 ? (unsigned)std::atoi(argv[2]) : 1000000;
+	std::printf("%8s %16s %16s\n", "threads", "global Mops/s", "sharded Mops/s");
+	for (unsigned n=1; n<=maxThreads; n *= 2)
+	{
+		global_lock_map global;
+		sharded_vector_map<unsigned,unsigned,6> sharded(KEYS);
+		double g = run(global, n, ops);
+		double s = run(sharded, n, ops);
+		std::printf("%8u %16.2f %16.2f\n", n, g, s);
+	}
+	return 0;
+}
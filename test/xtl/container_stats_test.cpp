@@ -0,0 +1,105 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Counters are compiled in for this file only. The containers are instantiated
+// with a counting_allocator tag so they do not collide with the instantiations
+// of other test files, which are compiled without counters.
+#define	XTL_CONTAINER_STATS	1
+
+#include <utility>
+#include <test.h>
+#include <xtl/memory.hpp>
+#include <xtl/unordered_vector_map.hpp>
+#include <xtl/unordered_vector_set.hpp>
+#include <xtl/unordered_block_vector_map.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+struct stats_tag { };
+
+template<class M>
+void TestMapStats(M& vmap)
+{
+    for (int i=0; i<100; ++i)
+        vmap[i] = i;
+    container_stats s = vmap.stats();
+    TEST_ASSERT(s.grows > 0);
+    TEST_ASSERT(s.finds == 0 && s.erase_swaps == 0);
+
+    vmap.reset_stats();
+    for (int i=0; i<200; ++i)
+        vmap.find(i);
+    s = vmap.stats();
+    TEST_ASSERT(s.finds == 200);
+    TEST_ASSERT(s.find_misses == 100);
+
+    vmap.reset_stats();
+    vmap.erase(99);     // the back element, nothing to move
+    vmap.erase(0);
+    vmap.erase(1);
+    s = vmap.stats();
+    TEST_ASSERT(s.erase_swaps == 2);
+    TEST_ASSERT(s.remaps == 0 && s.grows == 0);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_STATS)
+{
+    unordered_vector_map<int,int,counting_allocator<std::pair<int,int>,stats_tag> > vmap;
+    TestMapStats(vmap);
+    vmap.reset_stats();
+    vmap.reserve(1000);
+    vmap.reserve(500);
+    TEST_ASSERT(vmap.stats().remaps == 1);
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_STATS)
+{
+    unordered_block_vector_map<int,int,counting_allocator<std::pair<int,int>,stats_tag> > vmap;
+    TestMapStats(vmap);
+    vmap.reset_stats();
+    vmap[1 << 20] = 1;
+    vmap[(1 << 20) + 1] = 2;
+    TEST_ASSERT(vmap.stats().remaps == 1);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_SET_STATS)
+{
+    unordered_vector_set<int,counting_allocator<int,stats_tag> > vset;
+    for (int i=0; i<10; ++i)
+        vset.insert(i);
+    vset.reset_stats();
+    vset.find(3);
+    vset.find(30);
+    vset.erase(vset.begin(), vset.begin()+2);
+    container_stats s = vset.stats();
+    TEST_ASSERT(s.finds == 2 && s.find_misses == 1);
+    TEST_ASSERT(s.erase_swaps == 2);
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -0,0 +1,158 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <list>
+#include <string>
+#include <vector>
+#include <test.h>
+#include <xtl/index_list.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+template<class L, class C>
+bool same(const L& l, const C& c)
+{
+    if (l.size() != c.size()) return false;
+    typename C::const_iterator j = c.begin();
+    for (typename L::const_iterator i = l.begin(); i != l.end(); ++i, ++j)
+        if (*i != *j) return false;
+    return true;
+}
+
+REGISTER_TEST(INDEX_LIST)
+{
+    typedef index_list<int> list_type;
+    list_type::pool_type pool;
+    list_type l(pool);
+    std::list<int> ref;
+    TEST_ASSERT(l.empty() && l.begin() == l.end());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        if (i & 1)
+        {
+            l.push_back(i);
+            ref.push_back(i);
+        }
+        else
+        {
+            l.push_front(i);
+            ref.push_front(i);
+        }
+    }
+    TEST_ASSERT(same(l, ref) && pool.size() == 100);
+    TEST_ASSERT(l.front() == ref.front() && l.back() == ref.back());
+
+    // Erase every third element
+    list_type::iterator it = l.begin();
+    std::list<int>::iterator rt = ref.begin();
+    for (int n = 0; it != l.end(); ++n)
+    {
+        if (n % 3 == 0)
+        {
+            it = l.erase(it);
+            rt = ref.erase(rt);
+        }
+        else
+        {
+            ++it;
+            ++rt;
+        }
+    }
+    TEST_ASSERT(same(l, ref) && pool.size() == ref.size());
+
+    // Freed nodes are reused before the pool grows
+    size_t cap = pool.capacity();
+    it = l.insert(l.begin(), -1);
+    ref.push_front(-1);
+    l.insert(l.end(), -2);
+    ref.push_back(-2);
+    TEST_ASSERT(*it == -1 && pool.capacity() == cap && same(l, ref));
+
+    // Reverse iteration from end
+    std::list<int>::reverse_iterator rr = ref.rbegin();
+    for (list_type::iterator i = l.end(); i != l.begin(); ++rr) {
+        --i;
+        TEST_ASSERT(*i == *rr);
+    }
+
+    l.pop_front();
+    l.pop_back();
+    ref.pop_front();
+    ref.pop_back();
+    TEST_ASSERT(same(l, ref));
+
+    l.clear();
+    TEST_ASSERT(l.empty() && pool.size() == 0);
+}
+
+REGISTER_TEST(INDEX_LIST_SHARED_POOL)
+{
+    typedef index_list<std::string, std::allocator<std::string>, 16> list_type;
+    list_type::pool_type pool;
+    std::vector<list_type> lists;
+    for (int i = 0; i < 8; ++i)
+        lists.push_back(list_type(pool));
+
+    for (int i = 0; i < 200; ++i)
+        lists[i % 8].push_back(std::to_string(i));
+    TEST_ASSERT(pool.size() == 200);
+
+    // Splice moves nodes without reallocating them
+    list_type::index_type moved = lists[1].head();
+    lists[0].splice(lists[0].begin(), lists[1], lists[1].begin());
+    TEST_ASSERT(lists[0].head() == moved && lists[0].front() == "1");
+    TEST_ASSERT(lists[0].size() == 26 && lists[1].size() == 24);
+
+    size_t n = lists[2].size() + lists[3].size();
+    lists[2].splice(lists[3]);
+    TEST_ASSERT(lists[2].size() == n && lists[3].empty());
+    TEST_ASSERT(lists[2].back() == "195");
+
+    lists[3].push_back("x");
+    lists[3].swap(lists[4]);
+    TEST_ASSERT(lists[4].size() == 1 && lists[4].front() == "x");
+
+    // Destruction releases nodes to the pool
+    lists.pop_back();
+    TEST_ASSERT(pool.size() == 200 + 1 - 25);
+    memory_usage_info info = pool.memory_usage();
+    TEST_ASSERT(info.payload == pool.size()*sizeof(list_type::node_type));
+    TEST_ASSERT(info.slack >= 25*sizeof(list_type::node_type));
+    lists.clear();
+    TEST_ASSERT(pool.size() == 0);
+}
+
+REGISTER_TEST(INDEX_LIST_LINK_SIZE)
+{
+    // Links are two 32-bit indexes, half of intrusive_list on 64-bit targets
+    TEST_ASSERT(sizeof(index_list_node<uint32_t>) == 3*sizeof(uint32_t));
+}
+
+// ----------------------------------------------------------------------------
+}
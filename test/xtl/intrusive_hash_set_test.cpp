@@ -0,0 +1,156 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <test.h>
+#include <xtl/intrusive_hash_set.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+struct connection: public intrusive_hash_node
+{
+    std::string peer;
+    unsigned    id;
+};
+
+struct peer_of
+{
+    typedef std::string key_type;
+    const std::string& operator () (const connection& c) const { return c.peer; }
+};
+
+struct id_of
+{
+    typedef unsigned key_type;
+    unsigned operator () (const connection& c) const { return c.id; }
+};
+
+std::string peer_name(unsigned i)
+{
+    std::ostringstream os;
+    os << "10.0." << (i >> 8) << '.' << (i & 255) << ":443";
+    return os.str();
+}
+
+REGISTER_TEST(INTRUSIVE_HASH_SET)
+{
+    const unsigned N = 5000;
+    std::vector<connection> conns(N);
+    intrusive_hash_set<connection, peer_of> table;
+    TEST_ASSERT(table.empty() && table.find("x") == 0);
+
+    for (unsigned i=0; i<N; ++i) {
+        conns[i].peer = peer_name(i);
+        conns[i].id = i;
+        bool inserted = table.insert(&conns[i]).second;
+        TEST_ASSERT(inserted);
+        // Every item is found while the table rehashes
+        if (table.rehashing())
+            for (unsigned j=0; j<=i; j+=97)
+                TEST_ASSERT(table.find(conns[j].peer) == &conns[j]);
+    }
+    TEST_ASSERT(table.size() == N);
+    TEST_ASSERT(table.bucket_count() >= N/2);
+
+    connection dup;
+    dup.peer = peer_name(7);
+    std::pair<connection*, bool> r = table.insert(&dup);
+    TEST_ASSERT(!r.second && r.first == &conns[7]);
+
+    for (unsigned i=0; i<N; ++i)
+        TEST_ASSERT(table.find(peer_name(i)) == &conns[i]);
+
+    unsigned count = 0;
+    table.for_each([&count](connection&) { ++count; });
+    TEST_ASSERT(count == N);
+
+    for (unsigned i=0; i<N; i+=2) {
+        connection* erased = table.erase(peer_name(i));
+        TEST_ASSERT(erased == &conns[i]);
+    }
+    for (unsigned i=1; i<N; i+=4) {
+        bool erased = table.erase(&conns[i]);
+        TEST_ASSERT(erased);
+    }
+    bool erasedAgain = table.erase(&conns[1]);
+    connection* none = table.erase("none");
+    TEST_ASSERT(!erasedAgain && none == 0);
+    for (unsigned i=0; i<N; ++i)
+        TEST_ASSERT(table.test(peer_name(i)) == (i % 4 == 3));
+    TEST_ASSERT(table.size() == N/4);
+
+    // Items can be reinserted after erase
+    r = table.insert(&conns[0]);
+    TEST_ASSERT(r.second && table.find(conns[0].peer) == &conns[0]);
+
+    table.clear();
+    TEST_ASSERT(table.empty() && !table.rehashing() && table.find(conns[3].peer) == 0);
+}
+
+REGISTER_TEST(INTRUSIVE_HASH_SET_REHASH)
+{
+    const unsigned N = 1 << 16;
+    std::vector<connection> conns(N);
+    intrusive_hash_set<connection, id_of> table;
+    std::set<unsigned> check;
+    std::srand(2741);
+    for (unsigned i=0; i<4*N; ++i) {
+        unsigned k = (unsigned)std::rand() % N;
+        conns[k].id = k;
+        if (check.count(k)) {
+            connection* erased = table.erase(k);
+            TEST_ASSERT(erased == &conns[k]);
+            check.erase(k);
+        } else {
+            bool inserted = table.insert(&conns[k]).second;
+            TEST_ASSERT(inserted);
+            check.insert(k);
+        }
+        if ((i & 1023) == 0) {
+            unsigned p = (unsigned)std::rand() % N;
+            TEST_ASSERT((table.find(p) != 0) == (check.count(p) != 0));
+        }
+    }
+    TEST_ASSERT(table.size() == check.size());
+    unsigned count = 0;
+    table.for_each([&count, &check](connection& c) { TEST_ASSERT(check.count(c.id) == 1); ++count; });
+    TEST_ASSERT(count == check.size());
+
+    table.reserve(4*N);
+    TEST_ASSERT(!table.rehashing() && table.bucket_count() >= 4*N);
+    for (std::set<unsigned>::const_iterator i=check.begin(); i!=check.end(); ++i)
+        TEST_ASSERT(table.find(*i) == &conns[*i]);
+    TEST_ASSERT(table.memory_usage().index == table.bucket_count()*sizeof(void*));
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -25,6 +25,9 @@
 
 // Author Paul Glendenning
 
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
 #include <test.h>
 #include <xtl/unordered_vector_set.hpp>
 #include <xtl/intrusive_list.hpp>
@@ -463,5 +466,216 @@ REGISTER_TEST(INTRUSIVE_UNLINKABLE_LIST)
         storage3[n].unlink();
     TEST_ASSERT(lst3.begin() == lst3.end());
 }
+struct order
+{
+    unsigned key;
+    unsigned seq;
+};
+
+bool order_less(const order& a, const order& b) { return a.key < b.key; }
+
+template<class List>
+bool is_sorted_stable(const List& lst, size_t count)
+{
+    size_t n = 0;
+    const order* prev = 0;
+    for (typename List::const_iterator i=lst.begin(); i!=lst.end(); ++i, ++n) {
+        if (prev && (i->key < prev->key || (i->key == prev->key && i->seq < prev->seq)))
+            return false;
+        prev = &*i;
+    }
+    return n == count;
+}
+
+REGISTER_TEST(INTRUSIVE_LIST_SORT)
+{
+    const unsigned N = 100000;
+    std::vector< intrusive_list_item<order> > storage(N);
+    intrusive_list<order> lst;
+    lst.sort(order_less);
+    TEST_ASSERT(lst.empty());
+
+    srand(811);
+    for (unsigned i=0; i<N; ++i) {
+        order o = { (unsigned)rand() % 1000, i };
+        storage[i].assign(o);
+        lst.push_back(&storage[i]);
+    }
+    lst.sort(order_less);
+    TEST_ASSERT(lst.size() == N);
+    TEST_ASSERT(is_sorted_stable(lst, N));
+    // Reverse links are intact
+    unsigned count = 0;
+    for (intrusive_list<order>::reverse_iterator r=lst.rbegin(); r!=lst.rend(); ++r)
+        ++count;
+    TEST_ASSERT(count == N);
+
+    // Merge two sorted lists
+    intrusive_list<order> other;
+    std::vector< intrusive_list_item<order> > more(N/2);
+    for (unsigned i=0; i<N/2; ++i) {
+        order o = { (unsigned)rand() % 1000, N + i };
+        more[i].assign(o);
+        other.push_back(&more[i]);
+    }
+    other.sort(order_less);
+    lst.merge(other, order_less);
+    TEST_ASSERT(other.empty() && other.size() == 0);
+    TEST_ASSERT(lst.size() == N + N/2);
+    TEST_ASSERT(is_sorted_stable(lst, N + N/2));
+
+    // Single element and already sorted lists
+    intrusive_list<int> ints;
+    std::vector< intrusive_list_item<int> > values(5);
+    values[0].assign(7);
+    ints.push_back(&values[0]);
+    ints.sort();
+    TEST_ASSERT(ints.front() == 7 && ints.size() == 1);
+    for (unsigned i=1; i<5; ++i) {
+        values[i].assign((int)i);
+        ints.push_back(&values[i]);
+    }
+    ints.sort();
+    int expect[] = { 1, 2, 3, 4, 7 };
+    TEST_ASSERT(std::equal(ints.begin(), ints.end(), expect));
+
+}
+template<class List>
+bool list_equals(List& lst, const std::vector<int>& expect)
+{
+    if (!std::equal(expect.begin(), expect.end(), lst.begin()))
+        return false;
+    size_t n = 0;
+    for (typename List::iterator i=lst.begin(); i!=lst.end(); ++i)
+        ++n;
+    if (n != expect.size())
+        return false;
+    // Reverse links are intact
+    typename List::reverse_iterator r = lst.rbegin();
+    for (std::vector<int>::const_reverse_iterator e=expect.rbegin(); e!=expect.rend(); ++e, ++r)
+        if (r == lst.rend() || *r != *e)
+            return false;
+    return r == lst.rend();
+}
+
+REGISTER_TEST(INTRUSIVE_LIST_SPLICE)
+{
+    std::vector< intrusive_list_item<int> > storage(20);
+    intrusive_list<int> a, b;
+    for (int i=0; i<10; ++i) {
+        storage[i].assign(i);
+        a.push_back(&storage[i]);
+        storage[10+i].assign(10+i);
+        b.push_back(&storage[10+i]);
+    }
+
+    // Append a whole list
+    a.splice(b);
+    std::vector<int> expect;
+    for (int i=0; i<20; ++i)
+        expect.push_back(i);
+    TEST_ASSERT(a.size() == 20 && b.size() == 0 && b.empty());
+    TEST_ASSERT(list_equals(a, expect));
+
+    // Split at 15 then move 15..17 to the front of a
+    intrusive_list<int>::iterator at = a.begin();
+    for (int i=0; i<15; ++i) ++at;
+    a.split(at, b);
+    TEST_ASSERT(a.size() == 15 && b.size() == 5);
+    intrusive_list<int>::iterator last = b.begin();
+    ++last; ++last; ++last;
+    a.splice(a.begin(), b, b.begin(), last, 3);
+    TEST_ASSERT(a.size() == 18 && b.size() == 2);
+    int ea[] = { 15, 16, 17, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+    int eb[] = { 18, 19 };
+    TEST_ASSERT(list_equals(a, std::vector<int>(ea, ea+18)));
+    TEST_ASSERT(list_equals(b, std::vector<int>(eb, eb+2)));
+
+    // Counted range within the same list, move 0..2 to the end
+    intrusive_list<int>::iterator first = a.begin();
+    ++first; ++first; ++first;
+    last = first;
+    ++last; ++last; ++last;
+    a.splice(a.end(), a, first, last);
+    int ea2[] = { 15, 16, 17, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 0, 1, 2 };
+    TEST_ASSERT(a.size() == 18 && list_equals(a, std::vector<int>(ea2, ea2+18)));
+
+    // Whole list before a position, empty ranges
+    a.splice(a.begin(), b, b.begin(), b.begin());
+    TEST_ASSERT(b.size() == 2);
+    b.splice(b.begin(), a);
+    TEST_ASSERT(a.empty() && a.size() == 0 && b.size() == 20);
+    TEST_ASSERT(b.front() == 15 && b.back() == 19);
+
+    // Unlinkable lists split in O(1)
+    std::vector< intrusive_list_unlinkable_item<int> > items(6);
+    intrusive_list<int, intrusive_list_unlinkable_item<int> > u, v;
+    for (int i=0; i<6; ++i) {
+        items[i].assign(i);
+        u.push_back(&items[i]);
+    }
+    u.split(u.cast_it(&items[4]), v);
+    int eu[] = { 0, 1, 2, 3 };
+    int ev[] = { 4, 5 };
+    TEST_ASSERT(list_equals(u, std::vector<int>(eu, eu+4)));
+    TEST_ASSERT(list_equals(v, std::vector<int>(ev, ev+2)));
+    v.splice(v.begin(), u, u.begin(), u.cast_it(&items[2]));
+    int ev2[] = { 0, 1, 4, 5 };
+    TEST_ASSERT(list_equals(v, std::vector<int>(ev2, ev2+4)));
+    items[4].unlink();
+    int ev3[] = { 0, 1, 5 };
+    TEST_ASSERT(list_equals(v, std::vector<int>(ev3, ev3+3)));
+}
+struct tenant_order
+{
+    int                 id;
+    int                 tenant;
+    intrusive_list_hook lru_hook;
+    intrusive_list_hook tenant_hook;
+};
+
+bool id_less(const tenant_order& a, const tenant_order& b) { return a.id < b.id; }
+
+REGISTER_TEST(INTRUSIVE_LIST_MEMBER_HOOK)
+{
+    typedef XTL_MEMBER_HOOK(tenant_order, lru_hook) lru_item;
+    typedef XTL_MEMBER_HOOK(tenant_order, tenant_hook) tenant_item;
+    std::vector<tenant_order> orders(10);
+    intrusive_list<tenant_order, lru_item> lru;
+    intrusive_list<tenant_order, tenant_item> tenants[2];
+
+    for (int i=0; i<10; ++i) {
+        orders[i].id = 9 - i;
+        orders[i].tenant = i & 1;
+        lru.push_back(lru_item::item_of(&orders[i]));
+        tenants[i & 1].push_front(tenant_item::item_of(&orders[i]));
+        TEST_ASSERT(&lru.back() == &orders[i]);
+        TEST_ASSERT(&tenants[i & 1].front() == &orders[i]);
+    }
+    TEST_ASSERT(lru.size() == 10 && tenants[0].size() == 5 && tenants[1].size() == 5);
+
+    // Each list sees every object it holds
+    int n = 0;
+    for (intrusive_list<tenant_order, lru_item>::iterator i=lru.begin(); i!=lru.end(); ++i, ++n)
+        TEST_ASSERT(&*i == &orders[n]);
+    for (intrusive_list<tenant_order, tenant_item>::iterator i=tenants[1].begin(); i!=tenants[1].end(); ++i)
+        TEST_ASSERT(i->tenant == 1);
+
+    // Removing from one list leaves the other
+    lru.erase(lru.cast_it(lru_item::item_of(&orders[3])));
+    TEST_ASSERT(lru.size() == 9 && !orders[3].lru_hook.is_linked());
+    TEST_ASSERT(orders[3].tenant_hook.is_linked());
+
+    tenants[1].sort(id_less);
+    int last = -1;
+    for (intrusive_list<tenant_order, tenant_item>::const_iterator i=tenants[1].begin(); i!=tenants[1].end(); ++i) {
+        TEST_ASSERT(i->id > last);
+        last = i->id;
+    }
+    TEST_ASSERT(tenant_item::pointer_cast(tenants[1].head()) == &orders[9]);
+    TEST_ASSERT(lru_item::pointer_cast(lru.head()->next()) == &orders[1]);
+    TEST_ASSERT(lru_item::item_of(&orders[0]) == &orders[0].lru_hook);
+}
+
 // ----------------------------------------------------------------------------
 } // namespace
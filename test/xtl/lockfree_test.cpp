@@ -0,0 +1,160 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <test.h>
+#include <xtl/lockfree.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+struct message: public lockfree_node
+{
+    unsigned producer;
+    unsigned seq;
+};
+
+REGISTER_TEST(MPSC_QUEUE)
+{
+    mpsc_queue<message> q;
+    message* x = q.pop();
+    TEST_ASSERT(q.empty() && x == 0);
+
+    message m[3];
+    for (unsigned i=0; i<3; ++i) {
+        m[i].seq = i;
+        q.push(&m[i]);
+    }
+    TEST_ASSERT(!q.empty());
+    for (unsigned i=0; i<3; ++i) {
+        x = q.pop();
+        TEST_ASSERT(x == &m[i]);
+    }
+    x = q.pop();
+    TEST_ASSERT(q.empty() && x == 0);
+
+    // Reuse after pop
+    q.push(&m[1]);
+    x = q.pop();
+    message* y = q.pop();
+    TEST_ASSERT(x == &m[1] && y == 0);
+
+    // Per producer FIFO order with concurrent producers
+    const unsigned P = 4, N = 20000;
+    std::vector<message> storage(P*N);
+    std::vector<std::thread> producers;
+    for (unsigned p=0; p<P; ++p)
+        producers.push_back(std::thread([&storage, &q, p, N]() {
+            for (unsigned i=0; i<N; ++i) {
+                message& x = storage[p*N + i];
+                x.producer = p;
+                x.seq = i;
+                q.push(&x);
+            }
+        }));
+    std::vector<unsigned> next(P, 0);
+    unsigned received = 0;
+    while (received < P*N) {
+        x = q.pop();
+        if (!x) {
+            std::this_thread::yield();
+            continue;
+        }
+        TEST_ASSERT(x->seq == next[x->producer]);
+        ++next[x->producer];
+        ++received;
+    }
+    for (unsigned p=0; p<P; ++p)
+        producers[p].join();
+    x = q.pop();
+    TEST_ASSERT(x == 0);
+}
+
+REGISTER_TEST(TREIBER_STACK)
+{
+    treiber_stack<message> s;
+    message* x = s.pop();
+    TEST_ASSERT(s.empty() && x == 0);
+
+    message m[3];
+    for (unsigned i=0; i<3; ++i)
+        s.push(&m[i]);
+    x = s.pop();
+    TEST_ASSERT(x == &m[2]);
+    message* all = s.pop_all();
+    TEST_ASSERT(all == &m[1] && treiber_stack<message>::next(all) == &m[0]);
+    TEST_ASSERT(s.empty());
+
+    // Threads pop and push back a shared pool, no node may be lost or doubled
+    const unsigned T = 4, N = 64, ITER = 50000;
+    std::vector<message> pool(N);
+    for (unsigned i=0; i<N; ++i)
+        s.push(&pool[i]);
+    std::atomic<unsigned> misses(0);
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<T; ++t)
+        threads.push_back(std::thread([&s, &misses, ITER]() {
+            for (unsigned i=0; i<ITER; ++i) {
+                message* x = s.pop();
+                if (!x) {
+                    ++misses;
+                    continue;
+                }
+                s.push(x);
+            }
+        }));
+    for (unsigned t=0; t<T; ++t)
+        threads[t].join();
+    std::vector<bool> seen(N, false);
+    unsigned count = 0;
+    for (x = s.pop(); x; x = s.pop(), ++count) {
+        size_t i = x - &pool[0];
+        TEST_ASSERT(i < N && !seen[i]);
+        seen[i] = true;
+    }
+    TEST_ASSERT(count == N);
+
+    // A node address which overlaps the tag is rejected
+    if (sizeof(void*) == 8) {
+        message* high = reinterpret_cast<message*>(~uintptr_t(0) & ~uintptr_t(63));
+        bool thrown = false;
+        try {
+            s.push(high);
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        TEST_ASSERT(thrown && s.empty());
+    }
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -0,0 +1,170 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <string>
+#include <test.h>
+#include <xtl/lru_cache.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+REGISTER_TEST(LRU_CACHE)
+{
+    lru_cache<unsigned, std::string> cache(3);
+    std::string* missing = cache.get(1);
+    TEST_ASSERT(cache.empty() && missing == 0);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    TEST_ASSERT(cache.size() == 3 && cache.cost() == 3);
+
+    // 1 becomes most recently used so 2 is evicted
+    std::string* one = cache.get(1);
+    TEST_ASSERT(one && *one == "one");
+    cache.put(4, "four");
+    TEST_ASSERT(cache.size() == 3);
+    TEST_ASSERT(cache.peek(2) == 0);
+    std::string* again = cache.get(1);
+    TEST_ASSERT(again == one);
+    TEST_ASSERT(cache.hits() == 2 && cache.misses() == 1);
+
+    // Recency order
+    unsigned order[] = { 1, 4, 3 };
+    unsigned n = 0;
+    for (lru_cache<unsigned, std::string>::const_iterator i=cache.begin(); i!=cache.end(); ++i, ++n)
+        TEST_ASSERT(i->key == order[n]);
+    TEST_ASSERT(n == 3);
+
+    // Replace does not change the size
+    cache.put(3, "THREE");
+    TEST_ASSERT(*cache.peek(3) == "THREE" && cache.size() == 3);
+
+    bool erased = cache.erase(4);
+    bool erasedAgain = cache.erase(4);
+    TEST_ASSERT(erased && !erasedAgain);
+    bool evicted = cache.evict();
+    TEST_ASSERT(evicted && cache.size() == 1);
+    TEST_ASSERT(cache.peek(3) != 0);
+    cache.clear();
+    evicted = cache.evict();
+    TEST_ASSERT(cache.empty() && cache.cost() == 0 && !evicted);
+}
+
+REGISTER_TEST(LRU_CACHE_COST)
+{
+    lru_cache<unsigned, int> cache(10);
+    cache.put(1, 1, 4);
+    cache.put(2, 2, 4);
+    TEST_ASSERT(cache.cost() == 8);
+    cache.put(3, 3, 4);
+    TEST_ASSERT(cache.peek(1) == 0 && cache.cost() == 8);
+
+    // Too expensive to cache on its own, nothing is evicted
+    int* rejected = cache.put(4, 4, 11);
+    TEST_ASSERT(rejected == 0 && cache.peek(4) == 0);
+    TEST_ASSERT(cache.size() == 2 && cache.cost() == 8);
+
+    // Replacing a key with an oversized value only removes that key
+    rejected = cache.put(2, 20, 11);
+    TEST_ASSERT(rejected == 0 && cache.peek(2) == 0);
+    TEST_ASSERT(cache.size() == 1 && cache.cost() == 4 && *cache.peek(3) == 3);
+
+    cache.clear();
+    cache.put(5, 5, 5);
+    cache.put(6, 6, 5);
+    cache.set_capacity(6);
+    TEST_ASSERT(cache.size() == 1 && cache.peek(6) != 0);
+}
+
+REGISTER_TEST(LRU_CACHE_OVERSIZED)
+{
+    lru_cache<unsigned, int> cache(10);
+    for (unsigned k=0; k<5; ++k)
+        cache.put(k, int(k), 2);
+    TEST_ASSERT(cache.size() == 5 && cache.cost() == 10);
+
+    int* rejected = cache.put(50, 1, 11);
+    TEST_ASSERT(rejected == 0 && cache.peek(50) == 0);
+    TEST_ASSERT(cache.size() == 5 && cache.cost() == 10);
+    for (unsigned k=0; k<5; ++k)
+        TEST_ASSERT(cache.peek(k) != 0 && *cache.peek(k) == int(k));
+
+    // Recency order is unchanged
+    unsigned n = 4;
+    for (lru_cache<unsigned, int>::const_iterator i=cache.begin(); i!=cache.end(); ++i, --n)
+        TEST_ASSERT(i->key == n);
+}
+
+REGISTER_TEST(LRU_CACHE_RANDOM)
+{
+    const unsigned N = 500, K = 2000;
+    lru_cache<unsigned, unsigned> cache(N, K);
+    std::list<unsigned> check;
+    std::map<unsigned, unsigned> values;
+
+    std::srand(9181);
+    for (unsigned i=0; i<100000; ++i)
+    {
+        unsigned k = (unsigned)std::rand() % K;
+        if (std::rand() & 1)
+        {
+            cache.put(k, i);
+            check.remove(k);
+            check.push_front(k);
+            values[k] = i;
+            if (check.size() > N)
+                check.pop_back();
+        }
+        else
+        {
+            unsigned* v = cache.get(k);
+            std::list<unsigned>::iterator j = std::find(check.begin(), check.end(), k);
+            TEST_ASSERT((v != 0) == (j != check.end()));
+            if (v)
+            {
+                TEST_ASSERT(*v == values[k]);
+                check.erase(j);
+                check.push_front(k);
+            }
+        }
+    }
+    TEST_ASSERT(cache.size() == check.size());
+    std::list<unsigned>::const_iterator j = check.begin();
+    for (lru_cache<unsigned, unsigned>::const_iterator i=cache.begin(); i!=cache.end(); ++i, ++j)
+        TEST_ASSERT(i->key == *j);
+
+    // Steady state reuses slots
+    memory_usage_info info = cache.memory_usage();
+    TEST_ASSERT(info.payload + info.slack <= 1024*sizeof(lru_cache<unsigned, unsigned>::item_type));
+}
+
+// ----------------------------------------------------------------------------
+}
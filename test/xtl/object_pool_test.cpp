@@ -0,0 +1,164 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <test.h>
+#include <xtl/intrusive_list.hpp>
+#include <xtl/object_pool.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+struct order
+{
+    unsigned    id;
+    std::string owner;
+    static int  count;
+    order(unsigned i, const std::string& o): id(i), owner(o) { ++count; }
+    order(const order& other): id(other.id), owner(other.owner) { ++count; }
+    ~order() { --count; }
+};
+
+int order::count = 0;
+
+REGISTER_TEST(OBJECT_POOL)
+{
+    {
+        object_pool<order, 16> pool;
+        std::vector<order*> v;
+        for (unsigned i = 0; i < 100; ++i)
+            v.push_back(pool.allocate(i, "x"));
+        TEST_ASSERT(pool.size() == 100 && order::count == 100);
+        size_t cap = pool.capacity();
+
+        // Free the odd ids then reuse their slots
+        for (unsigned i = 1; i < 100; i += 2)
+            pool.free(v[i]);
+        TEST_ASSERT(pool.size() == 50 && order::count == 50);
+        unsigned sum = 0, n = 0;
+        pool.for_each_live([&](order& o) { sum += o.id; ++n; });
+        TEST_ASSERT(n == 50 && sum == 2450);
+
+        for (unsigned i = 1; i < 100; i += 2)
+            v[i] = pool.allocate(i, "y");
+        TEST_ASSERT(pool.capacity() == cap && pool.size() == 100);
+        for (unsigned i = 0; i < 100; ++i)
+            TEST_ASSERT(v[i]->id == i);
+
+        memory_usage_info info = pool.memory_usage();
+        TEST_ASSERT(info.payload == 100*sizeof(object_pool<order, 16>::slot_type));
+
+        // Remaining live objects are destroyed with the pool
+        pool.free(v[0]);
+        TEST_ASSERT(order::count == 99);
+    }
+    TEST_ASSERT(order::count == 0);
+
+    object_pool<int> ints;
+    ints.reserve(1000);
+    TEST_ASSERT(ints.capacity() == 1000 && ints.size() == 0);
+    int* p = ints.allocate(7);
+    TEST_ASSERT(*p == 7 && ints.capacity() == 1000);
+    ints.free(p);
+}
+
+struct book_entry
+{
+    order               value;
+    intrusive_list_hook hook;
+    book_entry(unsigned id): value(id, "bid") { }
+};
+
+REGISTER_TEST(OBJECT_POOL_INTRUSIVE_LIST)
+{
+    typedef XTL_MEMBER_HOOK(book_entry, hook) item_type;
+    typedef intrusive_list<book_entry, item_type> list_type;
+    object_pool<book_entry> pool;
+    list_type bids;
+
+    for (unsigned i = 0; i < 10; ++i)
+        bids.push_back(item_type::item_of(pool.allocate(i)));
+    TEST_ASSERT(bids.size() == 10);
+
+    // Cancel an order in O(1)
+    book_entry* e = &*++bids.begin();
+    bids.erase(bids.cast_it(item_type::item_of(e)));
+    pool.free(e);
+    TEST_ASSERT(bids.size() == 9 && pool.size() == 9);
+
+    while (!bids.empty())
+    {
+        e = &bids.front();
+        bids.pop_front();
+        pool.free(e);
+    }
+    TEST_ASSERT(pool.size() == 0 && order::count == 0);
+}
+
+REGISTER_TEST(OBJECT_POOL_CACHE)
+{
+    typedef object_pool<unsigned, 64> pool_type;
+    pool_type pool;
+    const unsigned THREADS = 4;
+    const unsigned N = 5000;
+    std::atomic<unsigned> errors(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < THREADS; ++t)
+    {
+        threads.push_back(std::thread([&pool, &errors, t, N]()
+        {
+            object_pool_cache<pool_type> cache(pool, 16);
+            std::vector<unsigned*> live;
+            for (unsigned i = 0; i < N; ++i)
+            {
+                live.push_back(cache.allocate(t*N + i));
+                if (i % 3 == 2)
+                {
+                    cache.free(live.front());
+                    live.erase(live.begin());
+                }
+            }
+            for (size_t i = 0; i < live.size(); ++i)
+            {
+                if (*live[i] / N != t) ++errors;
+                cache.free(live[i]);
+            }
+        }));
+    }
+    for (unsigned t = 0; t < THREADS; ++t)
+        threads[t].join();
+
+    TEST_ASSERT(errors == 0);
+    // Caches return their slots when destroyed
+    TEST_ASSERT(pool.size() == 0);
+}
+
+// ----------------------------------------------------------------------------
+}
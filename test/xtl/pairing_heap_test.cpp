@@ -0,0 +1,127 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+#include <vector>
+#include <test.h>
+#include <xtl/pairing_heap.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+struct deadline: public pairing_heap_node
+{
+    unsigned    when;
+    unsigned    id;
+    bool operator < (const deadline& other) const
+    {
+        return when < other.when || (when == other.when && id < other.id);
+    }
+};
+
+typedef std::pair<unsigned,unsigned> key_type;
+
+REGISTER_TEST(PAIRING_HEAP)
+{
+    std::vector<deadline> v(1000);
+    pairing_heap<deadline> heap;
+    std::set<key_type> ref;
+    std::srand(7);
+
+    for (unsigned i = 0; i < v.size(); ++i)
+    {
+        v[i].when = std::rand() % 500;
+        v[i].id = i;
+        heap.push(&v[i]);
+        ref.insert(key_type(v[i].when, i));
+        TEST_ASSERT(heap.top().when == ref.begin()->first);
+    }
+    TEST_ASSERT(heap.size() == 1000 && v[0].is_linked());
+
+    // Erase by handle, decrease and increase keys
+    for (unsigned i = 0; i < v.size(); i += 3)
+    {
+        ref.erase(key_type(v[i].when, i));
+        heap.erase(&v[i]);
+        TEST_ASSERT(!v[i].is_linked());
+    }
+    for (unsigned i = 1; i < v.size(); i += 3)
+    {
+        ref.erase(key_type(v[i].when, i));
+        v[i].when /= 2;
+        ref.insert(key_type(v[i].when, i));
+        heap.decrease(&v[i]);
+    }
+    for (unsigned i = 2; i < v.size(); i += 9)
+    {
+        ref.erase(key_type(v[i].when, i));
+        v[i].when += 100;
+        ref.insert(key_type(v[i].when, i));
+        heap.update(&v[i]);
+    }
+    TEST_ASSERT(heap.size() == ref.size());
+
+    // Pop in order
+    while (!ref.empty())
+    {
+        TEST_ASSERT(heap.top().id == ref.begin()->second);
+        TEST_ASSERT(heap.top().when == ref.begin()->first);
+        ref.erase(ref.begin());
+        heap.pop();
+    }
+    TEST_ASSERT(heap.empty() && heap.size() == 0);
+}
+
+REGISTER_TEST(PAIRING_HEAP_MERGE_CLEAR)
+{
+    std::vector<deadline> v(100);
+    pairing_heap<deadline> a, b;
+    for (unsigned i = 0; i < v.size(); ++i)
+    {
+        v[i].when = 100 - i;
+        v[i].id = i;
+        ((i & 1)? a: b).push(&v[i]);
+    }
+    a.pop();
+    a.merge(b);
+    TEST_ASSERT(b.empty() && a.size() == 99 && a.top().when == 2);
+
+    // Copies are unlinked
+    deadline copy = a.top();
+    TEST_ASSERT(!copy.is_linked());
+
+    a.clear();
+    TEST_ASSERT(a.empty());
+    for (unsigned i = 0; i < v.size(); ++i)
+        TEST_ASSERT(!v[i].is_linked());
+    b.push(&v[5]);
+    TEST_ASSERT(b.size() == 1 && &b.top() == &v[5]);
+}
+
+// ----------------------------------------------------------------------------
+}
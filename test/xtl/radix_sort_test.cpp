@@ -0,0 +1,148 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <test.h>
+#include <xtl/radix_sort.hpp>
+#include <xtl/block_vector.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+unsigned long long random64()
+{
+    return ((unsigned long long)std::rand() << 42) ^ ((unsigned long long)std::rand() << 21) ^ (unsigned long long)std::rand();
+}
+
+std::pair<int,int> make_item(int k, int i) { return std::make_pair(k, i); }
+int first_of(const std::pair<int,int>& x) { return x.first; }
+bool less_first(const std::pair<int,int>& a, const std::pair<int,int>& b) { return a.first < b.first; }
+
+REGISTER_TEST(RADIX_SORT_TEST)
+{
+    std::srand(4409);	// Make output predicable independent of test order
+
+    // Signed keys, including negatives
+    std::vector<int> a(50000);
+    for (size_t i=0; i<a.size(); ++i)
+        a[i] = std::rand() - RAND_MAX/2;
+    std::vector<int> expect(a);
+    std::sort(expect.begin(), expect.end());
+    radix_sort(a.begin(), a.end());
+    TEST_ASSERT(a == expect);
+
+    // 64 bit keys, all digits used
+    std::vector<unsigned long long> b(20000);
+    for (size_t i=0; i<b.size(); ++i)
+        b[i] = random64();
+    std::vector<unsigned long long> expect64(b);
+    std::sort(expect64.begin(), expect64.end());
+    radix_sort(b.begin(), b.end());
+    TEST_ASSERT(b == expect64);
+
+    // Narrow key span with a high constant part skips passes, 8 bit digits
+    std::vector<unsigned> c(10000);
+    for (size_t i=0; i<c.size(); ++i)
+        c[i] = 0xABC00000u | (std::rand() & 0xFFF);
+    std::vector<unsigned> expect32(c);
+    std::sort(expect32.begin(), expect32.end());
+    radix_sort<8>(c.begin(), c.end(), radix_identity<unsigned>());
+    TEST_ASSERT(c == expect32);
+
+    // Stable by key
+    std::vector<std::pair<int,int> > d;
+    for (int i=0; i<30000; ++i)
+        d.push_back(make_item(std::rand() % 100 - 50, i));
+    std::vector<std::pair<int,int> > expectp(d);
+    std::stable_sort(expectp.begin(), expectp.end(), less_first);
+    radix_sort(d.begin(), d.end(), first_of);
+    TEST_ASSERT(d == expectp);
+
+    // block_vector ranges
+    block_vector<unsigned, std::allocator<unsigned>, 256> bv;
+    for (int i=0; i<5000; ++i)
+        bv.push_back(std::rand());
+    std::vector<unsigned> expectbv(bv.begin(), bv.end());
+    std::sort(expectbv.begin(), expectbv.end());
+    radix_sort(bv.begin(), bv.end());
+    TEST_ASSERT(std::equal(bv.begin(), bv.end(), expectbv.begin()));
+
+    // Degenerate ranges
+    std::vector<int> e(100, 7);
+    radix_sort(e.begin(), e.end());
+    TEST_ASSERT(std::count(e.begin(), e.end(), 7) == 100);
+    radix_sort(e.begin(), e.begin());
+    radix_sort(e.begin(), e.begin()+1);
+}
+
+REGISTER_TEST(PARALLEL_RADIX_SORT_TEST)
+{
+    std::srand(4410);	// Make output predicable independent of test order
+
+    // Signed keys split across several chunks
+    std::vector<int> a(100000);
+    for (size_t i=0; i<a.size(); ++i)
+        a[i] = std::rand() - RAND_MAX/2;
+    std::vector<int> expect(a);
+    std::sort(expect.begin(), expect.end());
+    parallel_radix_sort(a.begin(), a.end(), radix_identity<int>(), 4);
+    TEST_ASSERT(a == expect);
+
+    // 64 bit keys, odd pass count leaves the result in the buffer
+    std::vector<unsigned long long> b(50000);
+    for (size_t i=0; i<b.size(); ++i)
+        b[i] = random64() & 0x1FFFFFull;
+    std::vector<unsigned long long> expect64(b);
+    std::sort(expect64.begin(), expect64.end());
+    parallel_radix_sort(b.begin(), b.end(), radix_identity<unsigned long long>(), 3);
+    TEST_ASSERT(b == expect64);
+
+    // Stable by key across chunk boundaries
+    std::vector<std::pair<int,int> > d;
+    for (int i=0; i<60000; ++i)
+        d.push_back(make_item(std::rand() % 100 - 50, i));
+    std::vector<std::pair<int,int> > expectp(d);
+    std::stable_sort(expectp.begin(), expectp.end(), less_first);
+    parallel_radix_sort<8>(d.begin(), d.end(), first_of, 5);
+    TEST_ASSERT(d == expectp);
+
+    // Equal keys and a single chunk
+    std::vector<int> e(20000, 7);
+    parallel_radix_sort(e.begin(), e.end(), radix_identity<int>(), 4);
+    TEST_ASSERT(std::count(e.begin(), e.end(), 7) == 20000);
+    std::vector<int> f(a.begin(), a.begin()+1000);
+    std::vector<int> expectf(f);
+    std::sort(expectf.begin(), expectf.end());
+    parallel_radix_sort(f.begin(), f.end(), radix_identity<int>(), 4);
+    TEST_ASSERT(f == expectf);
+}
+
+// ----------------------------------------------------------------------------
+} 
@@ -0,0 +1,135 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <test.h>
+#include <xtl/rcu_snapshot.hpp>
+#include <xtl/unordered_vector_map.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+typedef unordered_vector_map<unsigned,unsigned> table_type;
+
+// Counts live instances so the test can check reclamation.
+struct counted_table: public table_type
+{
+    static std::atomic<int> live;
+    counted_table() { ++live; }
+    counted_table(const counted_table& other): table_type(other) { ++live; }
+    ~counted_table() { --live; }
+};
+std::atomic<int> counted_table::live(0);
+
+REGISTER_TEST(RCU_SNAPSHOT_TEST)
+{
+    {
+        rcu_snapshot<counted_table> snap(new counted_table, 4);
+        rcu_snapshot<counted_table>::reader r(snap);
+        counted_table* next = snap.clone();
+        (*next)[1] = 10;
+        {
+            rcu_snapshot<counted_table>::guard g(r);
+            TEST_ASSERT(g->find(1) == g->end());
+            snap.publish(next);
+            // Still pinned by the guard
+            TEST_ASSERT(counted_table::live == 2);
+            TEST_ASSERT(g->find(1) == g->end());
+            size_t reclaimed = snap.reclaim();
+            TEST_ASSERT(reclaimed == 1);
+        }
+        size_t reclaimed = snap.reclaim();
+        TEST_ASSERT(reclaimed == 0);
+        TEST_ASSERT(counted_table::live == 1);
+        {
+            rcu_snapshot<counted_table>::guard g(r);
+            TEST_ASSERT(g->find(1)->second == 10);
+        }
+
+        // Slots are recycled when readers go away
+        {
+            rcu_snapshot<counted_table>::reader a(snap), b(snap), c(snap);
+            bool threw = false;
+            try { rcu_snapshot<counted_table>::reader d(snap); } catch (std::runtime_error&) { threw = true; }
+            TEST_ASSERT(threw);
+        }
+        rcu_snapshot<counted_table>::reader a(snap), b(snap), c(snap);
+    }
+    TEST_ASSERT(counted_table::live == 0);
+}
+
+REGISTER_TEST(RCU_SNAPSHOT_CONCURRENT)
+{
+    // Every version maps all keys to its version number. A reader which ever
+    // sees a mix of values has observed a torn or freed snapshot.
+    const unsigned KEYS = 512;
+    const unsigned VERSIONS = 200;
+    const unsigned READERS = 4;
+    counted_table* initial = new counted_table;
+    for (unsigned k=0; k<KEYS; ++k)
+        (*initial)[k] = 0;
+    {
+        rcu_snapshot<counted_table> snap(initial);
+        std::atomic<bool> done(false);
+        std::atomic<unsigned> torn(0);
+        std::vector<std::thread> readers;
+        for (unsigned t=0; t<READERS; ++t) {
+            readers.push_back(std::thread([&]() {
+                rcu_snapshot<counted_table>::reader r(snap);
+                unsigned last = 0;
+                while (!done) {
+                    rcu_snapshot<counted_table>::guard g(r);
+                    unsigned v = g->find(0)->second;
+                    if (v < last) ++torn;
+                    last = v;
+                    for (unsigned k=1; k<KEYS; ++k)
+                        if (g->find(k)->second != v) ++torn;
+                }
+            }));
+        }
+        for (unsigned v=1; v<=VERSIONS; ++v) {
+            counted_table* next = snap.clone();
+            for (unsigned k=0; k<KEYS; ++k)
+                (*next)[k] = v;
+            snap.publish(next);
+        }
+        done = true;
+        for (unsigned t=0; t<READERS; ++t)
+            readers[t].join();
+        TEST_ASSERT(torn == 0);
+        size_t reclaimed = snap.reclaim();
+        TEST_ASSERT(reclaimed == 0);
+        TEST_ASSERT(counted_table::live == 1);
+        TEST_ASSERT(snap.epoch() == VERSIONS + 1);
+    }
+    TEST_ASSERT(counted_table::live == 0);
+}
+
+// ----------------------------------------------------------------------------
+} 
@@ -0,0 +1,161 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+#include <test.h>
+#include <xtl/sharded_vector_map.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+REGISTER_TEST(SHARDED_VECTOR_MAP_TEST)
+{
+    const unsigned N = 16*1024;
+    sharded_vector_map<unsigned,unsigned> vmap(N);
+    std::map<unsigned,unsigned> check;
+    std::srand(1877);	// Make output predicable independent of test order
+    for (unsigned i=0; i<N; ++i) {
+        unsigned r = std::rand() % N;
+        if (r & 1) {
+            bool inserted = vmap.insert(std::make_pair(r, i));
+            bool expected = check.insert(std::make_pair(r, i)).second;
+            TEST_ASSERT(inserted == expected);
+        } else {
+            bool erased = vmap.erase(r+1);
+            bool expected = check.erase(r+1) != 0;
+            TEST_ASSERT(erased == expected);
+        }
+    }
+    TEST_ASSERT(vmap.size() == check.size());
+    unsigned v;
+    for (unsigned k=0; k<N; ++k) {
+        TEST_ASSERT(vmap.test(k) == (check.count(k) != 0));
+        TEST_ASSERT(vmap.find(k, v) == (check.count(k) != 0));
+        if (check.count(k)) TEST_ASSERT(v == check[k]);
+    }
+    std::map<unsigned,unsigned> visited;
+    vmap.for_each([&](unsigned k, unsigned x) { visited[k] = x; });
+    TEST_ASSERT(visited == check);
+    vmap.clear();
+    TEST_ASSERT(vmap.empty());
+}
+
+REGISTER_TEST(SHARDED_VECTOR_MAP_CONCURRENT)
+{
+    // Each thread owns a stripe of keys and also bumps a shared counter key.
+    const unsigned THREADS = 8;
+    const unsigned PER_THREAD = 20000;
+    sharded_vector_map<unsigned,unsigned> vmap;
+    vmap.assign(0, 0);
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<THREADS; ++t) {
+        threads.push_back(std::thread([&vmap, t]() {
+            for (unsigned i=1; i<=PER_THREAD; ++i) {
+                unsigned key = i*THREADS + t;
+                vmap.insert(std::make_pair(key, t));
+                vmap.update(0, [](unsigned& x) { ++x; });
+                if (i % 4 == 0) vmap.erase(key);
+            }
+        }));
+    }
+    for (unsigned t=0; t<THREADS; ++t)
+        threads[t].join();
+
+    unsigned v;
+    TEST_ASSERT(vmap.find(0, v) && v == THREADS*PER_THREAD);
+    TEST_ASSERT(vmap.size() == 1 + THREADS*(PER_THREAD - PER_THREAD/4));
+    for (unsigned t=0; t<THREADS; ++t) {
+        for (unsigned i=1; i<=PER_THREAD; ++i) {
+            bool found = vmap.find(i*THREADS + t, v);
+            TEST_ASSERT(found == (i % 4 != 0));
+            if (found) TEST_ASSERT(v == t);
+        }
+    }
+}
+
+REGISTER_TEST(SHARDED_VECTOR_MAP_OPTIMISTIC_READS)
+{
+    // Readers run unlocked while writers grow the shards past the reserve
+    // and overwrite values. A torn copy would break the key/check relation.
+    struct entry { unsigned key, check; };
+    const unsigned WRITERS = 4;
+    const unsigned READERS = 4;
+    const unsigned PER_WRITER = 20000;
+    const unsigned N = WRITERS*PER_WRITER;
+    typedef sharded_vector_map<unsigned,entry> map_type;
+    TEST_ASSERT(map_type::optimistic_reads);
+    map_type vmap;
+    std::atomic<bool> done(false);
+    std::atomic<unsigned> bad(0), hits(0);
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<WRITERS; ++t) {
+        threads.push_back(std::thread([&vmap, t]() {
+            for (unsigned i=0; i<PER_WRITER; ++i) {
+                unsigned key = i*WRITERS + t;
+                entry e = { key, ~key };
+                vmap.assign(key, e);
+                if (i % 3 == 0) vmap.erase(key);
+                else vmap.update(key, [](entry& x) { x.check = ~x.key; });
+            }
+        }));
+    }
+    for (unsigned t=0; t<READERS; ++t) {
+        threads.push_back(std::thread([&vmap, &done, &bad, &hits, t]() {
+            unsigned k = t;
+            while (!done.load()) {
+                entry e;
+                k = (k*7 + 13) % N;
+                if (vmap.find(k, e)) {
+                    if (e.key != k || e.check != ~k) ++bad;
+                    ++hits;
+                }
+            }
+        }));
+    }
+    for (unsigned t=0; t<WRITERS; ++t)
+        threads[t].join();
+    done.store(true);
+    for (unsigned t=WRITERS; t<threads.size(); ++t)
+        threads[t].join();
+
+    TEST_ASSERT(bad.load() == 0);
+    TEST_ASSERT(vmap.size() == N - WRITERS*((PER_WRITER+2)/3));
+    TEST_ASSERT(vmap.memory_usage().overhead > 0);
+    entry e;
+    for (unsigned k=0; k<N; ++k) {
+        bool found = vmap.find(k, e);
+        TEST_ASSERT(found == ((k/WRITERS) % 3 != 0));
+        if (found) TEST_ASSERT(e.key == k && e.check == ~k);
+    }
+}
+
+// ----------------------------------------------------------------------------
+} 
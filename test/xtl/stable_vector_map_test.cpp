@@ -0,0 +1,131 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <test.h>
+#include <xtl/stable_vector_map.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+REGISTER_TEST(STABLE_VECTOR_MAP_TEST)
+{
+    const int N = 8*1024;
+    const int ITER = 64*1024;
+    stable_vector_map<int,std::string> vmap;
+    std::map<int,std::string> check;
+    std::map<int,const std::string*> handles;
+    std::srand(3119);	// Make output predicable independent of test order
+
+    for (int i=0; i<ITER; ++i) {
+        int r = std::rand() % N;
+        if (std::rand() & 1) {
+            std::string v(1 + r % 7, char('a' + r % 26));
+            std::pair<stable_vector_map<int,std::string>::iterator, bool> x = vmap.insert(std::make_pair(r, v));
+            bool expect = check.insert(std::make_pair(r, v)).second;
+            TEST_ASSERT(x.second == expect);
+            if (x.second) handles[r] = &x.first->second;
+        } else {
+            size_t erased = vmap.erase(r);
+            size_t expect = check.erase(r);
+            TEST_ASSERT(erased == expect);
+            handles.erase(r);
+        }
+    }
+    TEST_ASSERT(vmap.size() == check.size());
+    TEST_ASSERT(vmap.holes() == vmap.slots() - vmap.size());
+
+    // Erase never moved anything, every handle still points at its value
+    for (std::map<int,const std::string*>::iterator it = handles.begin(); it != handles.end(); ++it)
+        TEST_ASSERT(vmap.find(it->first) != vmap.end() && &vmap.find(it->first)->second == it->second && *it->second == check[it->first]);
+
+    // Iteration skips holes
+    std::map<int,std::string> seen;
+    for (stable_vector_map<int,std::string>::const_iterator it = vmap.begin(); it != vmap.end(); ++it) {
+        bool unique = seen.insert(*it).second;
+        TEST_ASSERT(unique);
+    }
+    TEST_ASSERT(seen == check);
+
+    // Compact removes holes and keeps the index valid
+    vmap.compact();
+    TEST_ASSERT(vmap.holes() == 0 && vmap.slots() == check.size());
+    for (int k=0; k<N; ++k) {
+        TEST_ASSERT(vmap.test(k) == (check.count(k) != 0));
+        if (check.count(k)) TEST_ASSERT(vmap.find(k)->second == check[k]);
+    }
+    seen.clear();
+    for (stable_vector_map<int,std::string>::iterator it = vmap.begin(); it != vmap.end(); ++it)
+        seen.insert(*it);
+    TEST_ASSERT(seen == check);
+
+    // Holes are reused
+    stable_vector_map<int,std::string> copy(vmap);
+    size_t slots = copy.slots();
+    copy.erase(check.begin()->first);
+    copy[N+5] = "new";
+    TEST_ASSERT(copy.slots() == slots && copy.size() == check.size());
+    TEST_ASSERT(copy.find(N+5)->second == "new");
+    copy.clear();
+    TEST_ASSERT(copy.empty() && copy.begin() == copy.end() && !copy.test(N+5));
+    TEST_ASSERT(vmap.size() == check.size());
+}
+
+REGISTER_TEST(STABLE_VECTOR_MAP_WIDE_KEYS)
+{
+    // Keys above 2^32 must not alias the low 32 bits of a present key
+    stable_vector_map<uint64_t,int> wmap;
+    wmap[5] = 1;
+    const uint64_t wide = (uint64_t(1) << 32) + 5;
+    TEST_ASSERT(!wmap.test(wide) && wmap.find(wide) == wmap.end());
+    size_t erased = wmap.erase(wide);
+    TEST_ASSERT(!erased && wmap.size() == 1 && wmap.find(5)->second == 1);
+    TEST_ASSERT(wmap.capacity() < 1024);
+}
+
+REGISTER_TEST(STABLE_VECTOR_MAP_MEMORY_USAGE)
+{
+    stable_vector_map<unsigned, int> smap;
+    for (unsigned k=0; k<3000; ++k)
+        smap[k] = (int)k;
+    memory_usage_info before = smap.memory_usage();
+    TEST_ASSERT(before.payload == 3000*sizeof(std::pair<unsigned,int>));
+    for (unsigned k=0; k<3000; k+=2)
+        smap.erase(k);
+    memory_usage_info after = smap.memory_usage();
+    TEST_ASSERT(after.payload == 1500*sizeof(std::pair<unsigned,int>));
+    TEST_ASSERT(after.slack >= before.slack + 1500*sizeof(std::pair<unsigned,int>));
+    TEST_ASSERT(after.overhead > before.overhead);
+    smap.compact();
+    TEST_ASSERT(smap.memory_usage().slack < after.slack);
+}
+
+// ----------------------------------------------------------------------------
+} 
@@ -0,0 +1,120 @@
+// Copyright (C) 2008-2016, Solidra LLC. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer. Redistributions in binary
+// form must reproduce the above copyright notice, this list of conditions and
+// the following disclaimer in the documentation and/or other materials provided
+// with the distribution. Neither the name of the Solidra LLC nor the names of
+// its contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdlib>
+#include <vector>
+#include <test.h>
+#include <xtl/timer_wheel.hpp>
+
+using namespace xtl;
+
+namespace { 
+// ----------------------------------------------------------------------------
+
+template<unsigned Levels>
+void TestTimerWheel(uint64_t range, uint64_t start)
+{
+    typedef timer_wheel<unsigned, Levels> wheel_type;
+    const unsigned N = 3000;
+    std::vector<typename wheel_type::timer_type> timers(N);
+    std::vector<uint64_t> due(N, 0);
+    std::vector<unsigned> fired(N, 0);
+    wheel_type wheel(start);
+
+    std::srand(613);
+    for (unsigned i=0; i<N; ++i) {
+        timers[i].reference_cast().value = i;
+        due[i] = start + 1 + (((uint64_t)std::rand() << 16) ^ (uint64_t)std::rand()) % range;
+        wheel.schedule(&timers[i], due[i]);
+        TEST_ASSERT(wheel_type::pending(&timers[i]));
+    }
+    // Cancel every tenth timer, reschedule every seventh
+    for (unsigned i=0; i<N; i+=10)
+        wheel_type::cancel(&timers[i]);
+    for (unsigned i=3; i<N; i+=7) {
+        due[i] = start + 1 + (uint64_t)std::rand() % range;
+        wheel.schedule(&timers[i], due[i]);
+    }
+
+    uint64_t last = 0;
+    size_t total = 0;
+    while (wheel.now() < start + range + 1) {
+        uint64_t target = wheel.now() + 1 + (uint64_t)std::rand() % (range/50 + 1);
+        total += wheel.advance(target, [&](typename wheel_type::timer_type& t) {
+            unsigned i = t.reference_cast().value;
+            TEST_ASSERT(!wheel_type::pending(&t));
+            TEST_ASSERT(t.reference_cast().expires == due[i]);
+            TEST_ASSERT(wheel.now() == due[i]);
+            TEST_ASSERT(due[i] >= last);
+            last = due[i];
+            ++fired[i];
+        });
+        TEST_ASSERT(wheel.now() == target);
+    }
+    size_t expect = 0;
+    for (unsigned i=0; i<N; ++i) {
+        bool cancelled = (i % 10 == 0) && (i < 3 || (i - 3) % 7 != 0);
+        TEST_ASSERT(fired[i] == (cancelled? 0u: 1u));
+        expect += fired[i];
+    }
+    TEST_ASSERT(total == expect);
+    TEST_ASSERT(wheel.next_expiry() == ~uint64_t(0));
+}
+
+REGISTER_TEST(TIMER_WHEEL)
+{
+    TestTimerWheel<4>(100000, 0);
+    TestTimerWheel<4>(5000, 123456789);
+    // Two levels cover 4096 ticks, the rest go to the overflow list
+    TestTimerWheel<2>(60000, 77);
+}
+
+REGISTER_TEST(TIMER_WHEEL_RESCHEDULE)
+{
+    typedef timer_wheel<int> wheel_type;
+    wheel_type wheel(10);
+    wheel_type::timer_type t;
+    unsigned count = 0;
+
+    // Past expiry fires on the next tick
+    wheel.schedule(&t, 5);
+    TEST_ASSERT(t.reference_cast().expires == 11);
+
+    // A periodic timer rescheduled from the callback
+    wheel.schedule(&t, 20);
+    wheel.advance(1000, [&](wheel_type::timer_type& x) {
+        ++count;
+        wheel.schedule(&x, wheel.now() + 100);
+    });
+    TEST_ASSERT(count == 10 && wheel_type::pending(&t));
+    TEST_ASSERT(t.reference_cast().expires == 1020);
+    TEST_ASSERT(wheel.next_expiry() <= 1020);
+    wheel_type::cancel(&t);
+    size_t fired = wheel.advance(2000, [&](wheel_type::timer_type&) { ++count; });
+    TEST_ASSERT(fired == 0);
+}
+
+// ----------------------------------------------------------------------------
+}
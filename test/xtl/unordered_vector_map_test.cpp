@@ -26,6 +26,14 @@
 #include <iostream>
 #include <map>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <typeinfo>
 #include <test.h>
 #include <xtl/unordered_vector_map.hpp>
 #include <xtl/unordered_block_vector_map.hpp>
@@ -131,6 +139,469 @@ REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP)
     TestMap(vset);
 }
 
+template<class unordered_map_type>
+void TestShrink(unordered_map_type& vmap)
+{
+    // Touch a wide key range then erase all but a few low keys
+    for (int i=0; i<64*1024; i += 7)
+        vmap[i] = i;
+    size_t wide = vmap.capacity();
+    for (int i=700; i<64*1024; i += 7)
+        vmap.erase(i);
+    TEST_ASSERT(vmap.size() == 100);
+    vmap.shrink_to_fit();
+    TEST_ASSERT(vmap.capacity() < wide);
+    TEST_ASSERT(vmap.capacity() >= 694);
+    for (int i=0; i<64*1024; ++i)
+        TEST_ASSERT(vmap.test(i) == (i < 700 && i % 7 == 0));
+
+    // Repeated clear reuses the index, shrink after clear releases it
+    for (unsigned n=0; n<1000; ++n) {
+        vmap.clear();
+        vmap[n] = n;
+        vmap[n+1] = n;
+        TEST_ASSERT(vmap.size() == 2 && vmap.find(n)->second == n);
+        TEST_ASSERT(!vmap.test(n+2) && !vmap.test(n == 0? 2: n-1));
+    }
+    vmap.clear();
+    vmap.shrink_to_fit();
+    TEST_ASSERT(vmap.capacity() == 0);
+    TEST_ASSERT(vmap.find(5) == vmap.end());
+    vmap[40000] = 1;
+    TEST_ASSERT(vmap.size() == 1 && vmap[40000] == 1);
+}
+
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_SHRINK)
+{
+    unordered_vector_map<int,double> vmap;
+    TestShrink(vmap);
+}
+
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_SHRINK)
+{
+    unordered_block_vector_map<int,double> vmap;
+    TestShrink(vmap);
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_SPARSE)
+{
+    // Two clusters at the ends of a 2^40 key space only allocate index blocks
+    // for the touched ranges.
+    unordered_block_vector_map<uint64_t,uint64_t> vmap;
+    const uint64_t base = 1ULL << 40;
+    // Reserve only sizes the page directory
+    vmap.reserve(1 << 20);
+    TEST_ASSERT(vmap.capacity() == 0);
+    for (uint64_t i=0; i<5000; ++i) {
+        vmap[i*3] = i;
+        vmap[base-i*3] = i;
+    }
+    TEST_ASSERT(vmap.size() == 10000);
+    TEST_ASSERT(vmap.capacity() <= 2*16*1024);
+    for (uint64_t i=0; i<5000; ++i) {
+        TEST_ASSERT(vmap.find(i*3) != vmap.end() && vmap.find(i*3)->second == i);
+        TEST_ASSERT(vmap.find(base-i*3) != vmap.end() && vmap.find(base-i*3)->second == i);
+        TEST_ASSERT(!vmap.test(base-i*3-1));
+    }
+    TEST_ASSERT(!vmap.test(base/2));
+
+    // Erasing a cluster releases its index blocks
+    for (uint64_t i=1; i<5000; ++i)
+        vmap.erase(base-i*3);
+    TEST_ASSERT(vmap.capacity() <= 16*1024 + 1024);
+    vmap.erase(vmap.begin(), vmap.begin()+2500);
+    TEST_ASSERT(vmap.size() == 2501);
+    unordered_block_vector_map<uint64_t,uint64_t> copy(vmap);
+    vmap.erase(vmap.begin(), vmap.end());
+    TEST_ASSERT(vmap.empty() && vmap.capacity() == 0);
+    TEST_ASSERT(copy.size() == 2501);
+    for (unordered_block_vector_map<uint64_t,uint64_t>::iterator it=copy.begin(); it!=copy.end(); ++it)
+        TEST_ASSERT(copy.find(it->first) == it);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_ORDERED)
+{
+    const int N = 16*1024;
+    std::srand(2291);	// Make output predicable independent of test order
+    unordered_vector_map<int,int> vmap;
+    std::map<int,int> check;
+    for (int i=0; i<3000; ++i) {
+        int r = std::rand() % N;
+        vmap[r] = -r;
+        check[r] = -r;
+    }
+    // Enable after the fact, then keep it in sync across inserts and erases
+    vmap.set_ordered();
+    TEST_ASSERT(vmap.ordered());
+    for (int i=0; i<2000; ++i) {
+        int r = std::rand() % (2*N);
+        if (r & 1) {
+            vmap.erase(r/2);
+            check.erase(r/2);
+        } else {
+            vmap.insert(std::make_pair(r/2, -r/2));
+            check.insert(std::make_pair(r/2, -r/2));
+        }
+    }
+    vmap.erase(vmap.begin(), vmap.begin()+100);
+    for (std::map<int,int>::iterator it=check.begin(); it!=check.end(); )
+        if (vmap.test(it->first)) ++it; else check.erase(it++);
+    TEST_ASSERT(vmap.size() == check.size());
+
+    std::map<int,int>::iterator c = check.begin();
+    for (unordered_vector_map<int,int>::ordered_iterator it=vmap.ordered_begin(); it!=vmap.ordered_end(); ++it, ++c) {
+        TEST_ASSERT(c != check.end());
+        TEST_ASSERT(it.key() == size_t(c->first) && it->second == c->second);
+    }
+    TEST_ASSERT(c == check.end());
+
+    for (int k=0; k<N; k += 97) {
+        unordered_vector_map<int,int>::ordered_iterator lb = vmap.ordered_lower_bound(k);
+        unordered_vector_map<int,int>::ordered_iterator ub = vmap.ordered_upper_bound(k);
+        TEST_ASSERT(check.lower_bound(k) == check.end() ? lb == vmap.ordered_end() : lb->first == check.lower_bound(k)->first);
+        TEST_ASSERT(check.upper_bound(k) == check.end() ? ub == vmap.ordered_end() : ub->first == check.upper_bound(k)->first);
+    }
+    std::pair<unordered_vector_map<int,int>::ordered_iterator, unordered_vector_map<int,int>::ordered_iterator> r = vmap.ordered_range(1000, 2000);
+    TEST_ASSERT(std::distance(r.first, r.second) == std::distance(check.lower_bound(1000), check.lower_bound(2000)));
+
+    // Copies carry the view, clear resets it
+    unordered_vector_map<int,int> copy(vmap);
+    TEST_ASSERT(copy.ordered() && std::distance(copy.ordered_begin(), copy.ordered_end()) == (long)check.size());
+    vmap.clear();
+    TEST_ASSERT(vmap.ordered_begin() == vmap.ordered_end());
+    vmap[5] = 1;
+    vmap[3] = 1;
+    TEST_ASSERT(vmap.ordered_begin().key() == 3 && (++vmap.ordered_begin()).key() == 5);
+}
+
+template<class unordered_map_type>
+void TestBounds(unordered_map_type& vmap)
+{
+    std::srand(4481);	// Make output predicable independent of test order
+    std::map<int,int> check;
+    for (int i=0; i<2000; ++i) {
+        int r = (std::rand() % 8000) * 2;	// Even keys only, odd keys always miss
+        vmap[r] = i;
+        check[r] = i;
+    }
+    vmap.sort();
+    for (int k=-1; k<16002; ++k) {
+        typename unordered_map_type::iterator lb = vmap.lower_bound(k);
+        typename unordered_map_type::iterator ub = vmap.upper_bound(k);
+        std::map<int,int>::iterator clb = check.lower_bound(k), cub = check.upper_bound(k);
+        TEST_ASSERT(clb == check.end() ? lb == vmap.end() : (lb != vmap.end() && lb->first == clb->first));
+        TEST_ASSERT(cub == check.end() ? ub == vmap.end() : (ub != vmap.end() && ub->first == cub->first));
+        std::pair<typename unordered_map_type::iterator, typename unordered_map_type::iterator> r = vmap.equal_range(k);
+        TEST_ASSERT(r.first == lb && r.second == ub);
+        TEST_ASSERT((r.second - r.first) == (check.count(k) ? 1 : 0));
+    }
+    // Range count via bounds
+    const unordered_map_type& cmap = vmap;
+    TEST_ASSERT(cmap.lower_bound(12000) - cmap.lower_bound(4000) == std::distance(check.lower_bound(4000), check.lower_bound(12000)));
+    vmap.clear();
+    TEST_ASSERT(vmap.lower_bound(5) == vmap.end() && vmap.upper_bound(5) == vmap.end());
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_BOUNDS)
+{
+    unordered_vector_map<int,int> vmap;
+    TestBounds(vmap);
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_BOUNDS)
+{
+    unordered_block_vector_map<int,int> vmap;
+    TestBounds(vmap);
+}
+
+// Counts constructions so tests can check values are built in place.
+struct tracked
+{
+    static int constructed, copied, moved;
+    std::string s;
+    tracked(): s() { ++constructed; }
+    tracked(const char* x, size_t n): s(x, n) { ++constructed; }
+    tracked(const tracked& o): s(o.s) { ++copied; }
+    tracked(tracked&& o) noexcept: s(std::move(o.s)) { ++moved; }
+    tracked& operator = (const tracked& o) { s = o.s; ++copied; return *this; }
+    tracked& operator = (tracked&& o) noexcept { s = std::move(o.s); ++moved; return *this; }
+    static void reset() { constructed = copied = moved = 0; }
+};
+int tracked::constructed = 0;
+int tracked::copied = 0;
+int tracked::moved = 0;
+
+template<class unordered_map_type>
+void TestEmplace(unordered_map_type& vmap)
+{
+    vmap.reserve(64);
+    tracked::reset();
+    // Constructed in place, no copies or moves
+    bool inserted = vmap.try_emplace(3, "three", 5).second;
+    TEST_ASSERT(inserted);
+    TEST_ASSERT(tracked::constructed == 1 && tracked::copied == 0 && tracked::moved == 0);
+    // Key present, args untouched and nothing constructed
+    inserted = vmap.try_emplace(3, "other", 5).second;
+    TEST_ASSERT(!inserted);
+    TEST_ASSERT(tracked::constructed == 1 && vmap.find(3)->second.s == "three");
+    vmap[4];
+    TEST_ASSERT(tracked::constructed == 2 && tracked::copied == 0 && tracked::moved == 0);
+
+    tracked t("four", 4);
+    tracked::reset();
+    std::pair<typename unordered_map_type::iterator, bool> r = vmap.insert_or_assign(4, std::move(t));
+    TEST_ASSERT(!r.second && r.first->second.s == "four" && tracked::moved == 1 && tracked::copied == 0);
+    r = vmap.insert_or_assign(5, tracked("five", 4));
+    TEST_ASSERT(r.second && r.first->first == 5 && r.first->second.s == "five");
+    TEST_ASSERT(tracked::copied == 0);
+
+    tracked::reset();
+    r = vmap.insert(std::make_pair(6, tracked("six", 3)));
+    TEST_ASSERT(r.second && vmap.find(6)->second.s == "six" && tracked::copied == 0);
+    r = vmap.emplace(7, tracked("seven", 5));
+    TEST_ASSERT(r.second && vmap.find(7)->second.s == "seven" && tracked::copied == 0);
+    r = vmap.emplace(7, tracked("again", 5));
+    TEST_ASSERT(!r.second && vmap.find(7)->second.s == "seven");
+
+    // Index stays consistent across growth and erase
+    for (int i=8; i<5000; ++i)
+        vmap.try_emplace(i, "x", 1);
+    vmap.erase(3);
+    TEST_ASSERT(vmap.size() == 5000-4);
+    for (int i=4; i<5000; ++i)
+        TEST_ASSERT(vmap.find(i) != vmap.end() && vmap.find(i)->first == i);
+    TEST_ASSERT(!vmap.test(3));
+    TEST_ASSERT(tracked::copied == 0);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_EMPLACE)
+{
+    unordered_vector_map<int,tracked> vmap;
+    TestEmplace(vmap);
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_EMPLACE)
+{
+    unordered_block_vector_map<int,tracked> vmap;
+    TestEmplace(vmap);
+}
+
+struct pod_value
+{
+    unsigned a;
+    double b;
+};
+
+// Writes the key and a length prefixed string.
+struct string_serializer
+{
+    enum { raw = 0 };
+    bool write(std::ostream& os, const std::pair<int,std::string>& v) const
+    {
+        unsigned n = (unsigned)v.second.size();
+        return os.write((const char*)&v.first, sizeof(v.first)) && os.write((const char*)&n, sizeof(n)) && os.write(v.second.data(), n);
+    }
+    bool read(std::istream& is, std::pair<int,std::string>& v) const
+    {
+        unsigned n;
+        if (!is.read((char*)&v.first, sizeof(v.first)) || !is.read((char*)&n, sizeof(n)))
+            return false;
+        v.second.resize(n);
+        return (bool)is.read(&v.second[0], n);
+    }
+};
+
+// Overwrite a field of a saved snapshot.
+template<class T>
+std::string patch(const std::string& image, size_t offset, T value)
+{
+    std::string s(image);
+    std::memcpy(&s[offset], &value, sizeof(value));
+    return s;
+}
+
+template<class PodMap, class StringMap>
+void TestSnapshot()
+{
+    std::srand(6007);	// Make output predicable independent of test order
+    PodMap pmap, prestored;
+    for (int i=0; i<5000; ++i) {
+        int k = std::rand() % 20000;
+        pod_value v = { unsigned(k)*3, k*0.5 };
+        pmap[k] = v;
+    }
+    pmap.erase(pmap.begin()->first);
+    std::stringstream ps;
+    bool ok = pmap.save(ps);
+    TEST_ASSERT(ok);
+    // Key and value are packed without the padding of the pair
+    const size_t packed = sizeof(int) + sizeof(pod_value);
+    TEST_ASSERT(ps.str().size() == sizeof(snapshot_header) + pmap.size()*packed);
+    prestored[7].a = 1;	// Replaced by load
+    ok = prestored.load(ps);
+    TEST_ASSERT(ok);
+    TEST_ASSERT(prestored.size() == pmap.size());
+    for (typename PodMap::iterator it=pmap.begin(); it!=pmap.end(); ++it) {
+        typename PodMap::iterator x = prestored.find(it->first);
+        TEST_ASSERT(x != prestored.end() && x->second.a == it->second.a && x->second.b == it->second.b);
+    }
+    TEST_ASSERT(pmap.test(7) == prestored.test(7));
+    // Storage order is preserved
+    TEST_ASSERT((prestored.begin()->first == pmap.begin()->first));
+
+    StringMap smap, srestored;
+    for (int i=0; i<300; ++i)
+        smap[i*7] = std::string(i % 13, 'a' + i % 26);
+    std::stringstream ss;
+    ok = smap.save(ss, string_serializer());
+    TEST_ASSERT(ok);
+    ok = srestored.load(ss, string_serializer());
+    TEST_ASSERT(ok);
+    TEST_ASSERT(srestored.size() == smap.size());
+    for (int i=0; i<300; ++i)
+        TEST_ASSERT(srestored.find(i*7)->second == smap[i*7]);
+
+    // Mismatched or truncated input is rejected and leaves the map empty
+    std::stringstream bad(ps.str().substr(0, ps.str().size()/2));
+    std::stringstream copy(ps.str());
+    ok = srestored.load(copy, string_serializer());
+    TEST_ASSERT(!ok && srestored.empty());
+    ok = prestored.load(bad);
+    TEST_ASSERT(!ok);
+    TEST_ASSERT(prestored.empty() && !prestored.test(pmap.begin()->first));
+
+    // A corrupt count larger than the stream fails without allocating for it
+    const std::string image = ps.str();
+    std::stringstream huge(patch(image, offsetof(snapshot_header, count), uint64_t(0xFFFFFFF0ULL)));
+    ok = prestored.load(huge);
+    TEST_ASSERT(!ok && prestored.empty());
+
+    // Duplicate and out of domain keys are rejected
+    const size_t first = sizeof(snapshot_header);
+    std::stringstream dup(patch(image, first + packed, pmap.begin()->first));
+    ok = prestored.load(dup);
+    TEST_ASSERT(!ok && prestored.empty());
+    std::stringstream outside(patch(image, first, int(-1)));
+    ok = prestored.load(outside);
+    TEST_ASSERT(!ok && prestored.empty());
+    std::stringstream narrow(patch(image, offsetof(snapshot_header, domain), uint64_t(pmap.size())));
+    ok = prestored.load(narrow);
+    TEST_ASSERT(!ok && prestored.empty());
+    prestored[3].a = 3;
+    TEST_ASSERT(prestored.size() == 1 && prestored.find(3)->second.a == 3);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_SNAPSHOT)
+{
+    TestSnapshot<unordered_vector_map<int,pod_value>, unordered_vector_map<int,std::string> >();
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_SNAPSHOT)
+{
+    TestSnapshot<unordered_block_vector_map<int,pod_value>, unordered_block_vector_map<int,std::string> >();
+}
+
+template<class unordered_map_type>
+void TestParallelSort(unordered_map_type& vmap)
+{
+    std::srand(5303);	// Make output predicable independent of test order
+    std::map<int,int> check;
+    while (check.size() < 50000) {
+        int k = std::rand() % 400000;
+        vmap[k] = -k;
+        check[k] = -k;
+    }
+    unordered_map_type copy(vmap);
+    vmap.sort(parallel_policy(5));
+    copy.sort(seq);
+    std::map<int,int>::iterator c = check.begin();
+    for (typename unordered_map_type::iterator it=vmap.begin(); it!=vmap.end(); ++it, ++c)
+        TEST_ASSERT(it->first == c->first && it->second == c->second);
+    TEST_ASSERT(std::equal(vmap.begin(), vmap.end(), copy.begin()));
+    // Index rebuilt
+    for (c=check.begin(); c!=check.end(); ++c)
+        TEST_ASSERT(vmap.find(c->first) != vmap.end() && vmap.find(c->first)->first == c->first);
+    TEST_ASSERT(vmap.lower_bound(200000)->first == check.lower_bound(200000)->first);
+    vmap.remap(par);
+    for (c=check.begin(); c!=check.end(); ++c)
+        TEST_ASSERT(vmap.find(c->first)->second == c->second);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_PARALLEL_SORT)
+{
+    unordered_vector_map<int,int> vmap;
+    TestParallelSort(vmap);
+
+    // Run counts which do not divide evenly
+    for (unsigned t=1; t<=9; ++t) {
+        std::vector<unsigned> v(37000 + t);
+        for (size_t i=0; i<v.size(); ++i)
+            v[i] = (unsigned)std::rand();
+        std::vector<unsigned> expect(v);
+        std::sort(expect.begin(), expect.end());
+        parallel_sort(v.begin(), v.end(), std::less<unsigned>(), t);
+        TEST_ASSERT(v == expect);
+    }
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_PARALLEL_SORT)
+{
+    unordered_block_vector_map<int,int> vmap;
+    TestParallelSort(vmap);
+}
+
+template<class M>
+void TestMemoryUsage(M& vmap)
+{
+    memory_usage_info info = vmap.memory_usage();
+    TEST_ASSERT(info.payload == 0);
+    for (int i=0; i<5000; i+=3)
+        vmap[i] = i;
+    info = vmap.memory_usage();
+    TEST_ASSERT(info.payload == vmap.size()*sizeof(typename M::value_type));
+    TEST_ASSERT(info.index >= 4998*sizeof(unsigned));
+    TEST_ASSERT(info.total() == info.payload + info.index + info.slack + info.overhead);
+}
+
+struct uvmap_memory_tag { };
+struct ubvmap_memory_tag { };
+static std::ptrdiff_t memory_hook_bytes = 0;
+static void memory_hook_count(const std::type_info& tag, std::ptrdiff_t delta)
+{
+    if (tag == typeid(uvmap_memory_tag))
+        memory_hook_bytes += delta;
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_MEMORY_USAGE)
+{
+    memory_hook() = memory_hook_count;
+    {
+        unordered_vector_map<int,int,counting_allocator<std::pair<int,int>,uvmap_memory_tag> > vmap;
+        TestMemoryUsage(vmap);
+        vmap.set_ordered(true);
+        TEST_ASSERT(memory_counter<uvmap_memory_tag>::bytes() == (std::ptrdiff_t)vmap.memory_usage().total());
+        TEST_ASSERT(memory_hook_bytes == memory_counter<uvmap_memory_tag>::bytes());
+    }
+    TEST_ASSERT(memory_counter<uvmap_memory_tag>::bytes() == 0);
+    TEST_ASSERT(memory_hook_bytes == 0);
+    memory_hook() = 0;
+}
+
+REGISTER_TEST(UNORDERED_BLOCK_VECTOR_MAP_MEMORY_USAGE)
+{
+    {
+        unordered_block_vector_map<int,int,counting_allocator<std::pair<int,int>,ubvmap_memory_tag> > vmap;
+        TestMemoryUsage(vmap);
+        vmap[1 << 24] = 1;
+        TEST_ASSERT(memory_counter<ubvmap_memory_tag>::bytes() == (std::ptrdiff_t)vmap.memory_usage().total());
+        vmap.erase(1 << 24);
+        TEST_ASSERT(memory_counter<ubvmap_memory_tag>::bytes() == (std::ptrdiff_t)vmap.memory_usage().total());
+    }
+    TEST_ASSERT(memory_counter<ubvmap_memory_tag>::bytes() == 0);
+}
+
 // ----------------------------------------------------------------------------
 } 
 
@@ -25,8 +25,15 @@
 
 #include <cstdlib>
 #include <set>
+#include <sstream>
+#include <cstring>
 #include <test.h>
 #include <xtl/unordered_vector_set.hpp>
+#include <xtl/adaptive_vector_set.hpp>
+#include <xtl/unordered_vector_map.hpp>
+#include <xtl/set_algorithm.hpp>
+#include <algorithm>
+#include <iterator>
 
 using namespace xtl;
 
@@ -98,5 +105,294 @@ REGISTER_TEST(UNORDERED_VECTOR_SET_TEST)
     TEST_ASSERT(vset.begin() == vset.end());
 }
 
+template<class Set>
+std::set<int> to_set(const Set& s)
+{
+    std::set<int> result;
+    for (typename Set::const_iterator it = s.begin(); it != s.end(); ++it)
+        result.insert(container_traits<Set>::key_from_value(*it));
+    return result;
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_SET_ALGEBRA)
+{
+    const unsigned N = 64*1024;
+    std::srand(5417);	// Make output predicable independent of test order
+
+    // Sizes chosen so each operand is the smaller one at least once and the
+    // parallel versions split into several chunks.
+    const unsigned sizes[][2] = { {20000, 300}, {300, 20000}, {30000, 30000}, {0, 100} };
+    for (unsigned t=0; t<sizeof(sizes)/sizeof(sizes[0]); ++t) {
+        unordered_vector_set<int> a(N), b(N);
+        unordered_vector_map<int,int> m(N);
+        while (a.size() < sizes[t][0]) {
+            int r = std::rand() & (N - 1);
+            a.insert(r);
+            m[r] = -r;
+        }
+        while (b.size() < sizes[t][1])
+            b.insert(std::rand() & (N - 1));
+
+        std::set<int> sa = to_set(a), sb = to_set(b), expect;
+        std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::inserter(expect, expect.end()));
+        std::set<int> expectDiff;
+        std::set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(), std::inserter(expectDiff, expectDiff.end()));
+        std::set<int> expectUnion;
+        std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::inserter(expectUnion, expectUnion.end()));
+
+        // Out of place
+        unordered_vector_set<int> r1, r2, r3, p1, p2, p3;
+        set_intersection(a, b, r1);
+        set_difference(a, b, r2);
+        set_union(a, b, r3);
+        parallel_set_intersection(a, b, p1, 4);
+        parallel_set_difference(a, b, p2, 4);
+        parallel_set_union(a, b, p3, 4);
+        TEST_ASSERT(to_set(r1) == expect && to_set(p1) == expect);
+        TEST_ASSERT(to_set(r2) == expectDiff && to_set(p2) == expectDiff);
+        TEST_ASSERT(to_set(r3) == expectUnion && to_set(p3) == expectUnion);
+
+        // Map keys, values come from the map operand
+        unordered_vector_map<int,int> mr;
+        parallel_set_intersection(m, b, mr, 4);
+        TEST_ASSERT(to_set(mr) == expect);
+        for (unordered_vector_map<int,int>::iterator it = mr.begin(); it != mr.end(); ++it)
+            TEST_ASSERT(it->second == -it->first);
+
+        // In place
+        unordered_vector_set<int> i1(a), i2(a), i3(a);
+        i1.set_intersect(b);
+        i2.set_complement(b);
+        i3.set_union(b);
+        TEST_ASSERT(to_set(i1) == expect);
+        TEST_ASSERT(to_set(i2) == expectDiff);
+        TEST_ASSERT(to_set(i3) == expectUnion);
+        for (std::set<int>::iterator it = expect.begin(); it != expect.end(); ++it)
+            TEST_ASSERT(i1.test(*it) && *i1.find(*it) == *it);
+        for (std::set<int>::iterator it = expectDiff.begin(); it != expectDiff.end(); ++it)
+            TEST_ASSERT(i2.test(*it) && *i2.find(*it) == *it);
+
+        unordered_vector_map<int,int> m1(m), m2(m);
+        m1.set_intersect(b);
+        m2.set_complement(b);
+        TEST_ASSERT(to_set(m1) == expect);
+        TEST_ASSERT(to_set(m2) == expectDiff);
+        for (std::set<int>::iterator it = expect.begin(); it != expect.end(); ++it)
+            TEST_ASSERT(m1.find(*it) != m1.end() && m1.find(*it)->second == -*it);
+    }
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_MAP_INTERSECT_STALE_INDEX)
+{
+    // Erasing 0 leaves a stale _map[0] entry which must not match a slot
+    // emptied while the smaller operand is probed.
+    unordered_vector_map<int,int> m;
+    m[0] = 10;
+    m[5] = 50;
+    m[6] = 60;
+    m[7] = 70;
+    m.erase(0);
+    unordered_vector_set<int> other;
+    other.insert(7);
+    other.insert(0);
+    m.set_intersect(other);
+    TEST_ASSERT(m.size() == 1 && !m.test(0));
+    TEST_ASSERT(m.find(7) != m.end() && m.find(7)->second == 70);
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_SET_ORDERED)
+{
+    const int N = 16*1024;
+    std::srand(733);	// Make output predicable independent of test order
+    unordered_vector_set<int> vset;
+    vset.set_ordered();
+    std::set<int> check;
+    for (int i=0; i<4000; ++i) {
+        int r = std::rand() % (2*N);
+        if (r % 3 == 0) {
+            vset.erase(r/2);
+            check.erase(r/2);
+        } else {
+            vset.insert(r/2);
+            check.insert(r/2);
+        }
+    }
+    TEST_ASSERT(std::equal(vset.ordered_begin(), vset.ordered_end(), check.begin()));
+    TEST_ASSERT(std::distance(vset.ordered_begin(), vset.ordered_end()) == (long)check.size());
+
+    unordered_vector_set<int> other;
+    for (int i=0; i<N; i += 3)
+        other.insert(i);
+    unordered_vector_set<int> i1(vset), i2(vset);
+    i1.set_intersect(other);
+    i2.set_complement(other);
+    TEST_ASSERT(std::equal(i1.ordered_begin(), i1.ordered_end(), to_set(i1).begin()));
+    TEST_ASSERT(std::distance(i1.ordered_begin(), i1.ordered_end()) == (long)i1.size());
+    TEST_ASSERT(std::equal(i2.ordered_begin(), i2.ordered_end(), to_set(i2).begin()));
+    TEST_ASSERT(std::distance(i2.ordered_begin(), i2.ordered_end()) == (long)i2.size());
+
+    TEST_ASSERT(*vset.ordered_lower_bound(*check.begin()) == *check.begin());
+    TEST_ASSERT(vset.ordered_upper_bound(*check.rbegin()) == vset.ordered_end());
+    std::pair<unordered_vector_set<int>::ordered_iterator, unordered_vector_set<int>::ordered_iterator> r = vset.ordered_range(100, 900);
+    TEST_ASSERT(std::equal(r.first, r.second, check.lower_bound(100)));
+    TEST_ASSERT(std::distance(r.first, r.second) == std::distance(check.lower_bound(100), check.lower_bound(900)));
+
+    bool inserted = vset.emplace(*check.begin()).second;
+    TEST_ASSERT(!inserted);
+    unordered_vector_set<int>::iterator hinted = vset.emplace_hint(vset.begin(), 2*N);
+    TEST_ASSERT(*hinted == 2*N);
+    TEST_ASSERT(vset.ordered_upper_bound(*check.rbegin()).key() == 2*N);
+    vset.set_ordered(false);
+    TEST_ASSERT(!vset.ordered());
+    vset.clear();
+    vset.set_ordered();
+    TEST_ASSERT(vset.ordered_begin() == vset.ordered_end());
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_SET_BOUNDS)
+{
+    std::srand(90210);	// Make output predicable independent of test order
+    unordered_vector_set<int> vset;
+    std::set<int> check;
+    for (int i=0; i<1500; ++i) {
+        int r = (std::rand() % 5000) * 3;
+        vset.insert(r);
+        check.insert(r);
+    }
+    unordered_vector_set<int> psorted(vset);
+    vset.sort();
+    psorted.sort(parallel_policy(3));
+    TEST_ASSERT(std::equal(vset.begin(), vset.end(), check.begin()));
+    TEST_ASSERT(std::equal(psorted.begin(), psorted.end(), check.begin()));
+    for (std::set<int>::iterator it=check.begin(); it!=check.end(); ++it)
+        TEST_ASSERT(*psorted.find(*it) == *it);
+    for (int k=-2; k<15003; ++k) {
+        unordered_vector_set<int>::iterator lb = vset.lower_bound(k), ub = vset.upper_bound(k);
+        TEST_ASSERT(std::distance(vset.begin(), lb) == std::distance(check.begin(), check.lower_bound(k)));
+        TEST_ASSERT(std::distance(vset.begin(), ub) == std::distance(check.begin(), check.upper_bound(k)));
+        TEST_ASSERT(vset.equal_range(k) == std::make_pair(lb, ub));
+    }
+}
+
+REGISTER_TEST(UNORDERED_VECTOR_SET_SNAPSHOT)
+{
+    std::srand(1123);	// Make output predicable independent of test order
+    unordered_vector_set<unsigned> vset, restored;
+    for (unsigned i=0; i<4000; ++i)
+        vset.insert(std::rand() % 50000);
+    std::stringstream ss;
+    bool ok = vset.save(ss);
+    TEST_ASSERT(ok);
+    restored.set_ordered();
+    ok = restored.load(ss);
+    TEST_ASSERT(ok);
+    TEST_ASSERT(std::equal(vset.begin(), vset.end(), restored.begin()) && restored.size() == vset.size());
+    for (unsigned k=0; k<50000; ++k)
+        TEST_ASSERT(restored.test(k) == vset.test(k));
+    std::set<unsigned> sorted(vset.begin(), vset.end());
+    TEST_ASSERT(std::equal(restored.ordered_begin(), restored.ordered_end(), sorted.begin()));
+
+    // A map snapshot is not a set snapshot
+    unordered_vector_map<unsigned,unsigned> vmap;
+    vmap[1] = 2;
+    std::stringstream ms;
+    ok = vmap.save(ms);
+    TEST_ASSERT(ok);
+    ok = restored.load(ms);
+    TEST_ASSERT(!ok && restored.empty());
+
+    // Duplicate keys are rejected
+    std::string image = ss.str();
+    std::memcpy(&image[sizeof(snapshot_header) + sizeof(unsigned)], &image[sizeof(snapshot_header)], sizeof(unsigned));
+    std::stringstream dup(image);
+    ok = restored.load(dup);
+    TEST_ASSERT(!ok && restored.empty());
+}
+
+template<class Set>
+void TestAdaptive(Set& aset, std::set<unsigned>& check, unsigned domain, unsigned n)
+{
+    while (check.size() < n) {
+        unsigned k = std::rand() % domain;
+        bool inserted = aset.insert(k).second;
+        bool expect = check.insert(k).second;
+        TEST_ASSERT(inserted == expect);
+    }
+    TEST_ASSERT(aset.size() == check.size());
+    TEST_ASSERT(to_set(aset) == std::set<int>(check.begin(), check.end()));
+    for (unsigned k=0; k<domain; k += 3)
+        TEST_ASSERT(aset.test(k) == (check.count(k) != 0) && (aset.find(k) != aset.end()) == aset.test(k));
+    TEST_ASSERT(aset.count(domain/4, domain/2) == (size_t)std::distance(check.lower_bound(domain/4), check.lower_bound(domain/2)));
+}
+
+REGISTER_TEST(ADAPTIVE_VECTOR_SET_TEST)
+{
+    const unsigned N = 64*1024;
+    std::srand(8111);	// Make output predicable independent of test order
+    adaptive_vector_set<unsigned> aset;
+    std::set<unsigned> check;
+
+    // Sparse over a wide domain
+    aset.insert(N-1);
+    check.insert(N-1);
+    TestAdaptive(aset, check, N, 200);
+    TEST_ASSERT(!aset.dense());
+
+    // Grows dense, iteration is then in key order
+    TestAdaptive(aset, check, N, N/8);
+    TEST_ASSERT(aset.dense());
+    TEST_ASSERT(std::equal(aset.begin(), aset.end(), check.begin()));
+
+    // Hysteresis keeps it dense until well below the switch point
+    while (check.size() > N/64) {
+        unsigned k = *check.begin();
+        size_t erased = aset.erase(k);
+        size_t again = aset.erase(k);
+        TEST_ASSERT(erased == 1 && again == 0);
+        check.erase(k);
+    }
+    TEST_ASSERT(aset.dense());
+    while (check.size() > N/256) {
+        aset.erase(*check.rbegin());
+        check.erase(*check.rbegin());
+    }
+    TEST_ASSERT(!aset.dense());
+    TestAdaptive(aset, check, N, check.size());
+
+    // Works with the XTL set algebra
+    unordered_vector_set<int> other, result;
+    for (int k=0; k<(int)N; k += 2)
+        other.insert(k);
+    set_intersection(aset, other, result);
+    TEST_ASSERT(result.size() == (size_t)std::count_if(check.begin(), check.end(), [](unsigned k) { return k % 2 == 0; }));
+
+    // Forced layouts
+    adaptive_vector_set<unsigned, dense_set_policy> dset;
+    adaptive_vector_set<unsigned, sparse_set_policy> sset;
+    std::set<unsigned> dcheck, scheck;
+    TestAdaptive(dset, dcheck, N, 10);
+    TestAdaptive(sset, scheck, N, N/2);
+    TEST_ASSERT(dset.dense() && !sset.dense());
+    dset.clear();
+    TEST_ASSERT(dset.empty() && dset.begin() == dset.end());
+}
+
+REGISTER_TEST(ADAPTIVE_VECTOR_SET_MEMORY_USAGE)
+{
+    const unsigned N = 1 << 16;
+    adaptive_vector_set<unsigned> aset(N);
+    for (unsigned k=0; k<N/1024; ++k)
+        aset.insert(k*1024);
+    TEST_ASSERT(!aset.dense());
+    memory_usage_info sparse = aset.memory_usage();
+    TEST_ASSERT(sparse.payload == aset.size()*sizeof(unsigned));
+    for (unsigned k=0; k<N; k+=2)
+        aset.insert(k);
+    TEST_ASSERT(aset.dense());
+    memory_usage_info dense = aset.memory_usage();
+    TEST_ASSERT(dense.payload >= N/8);
+    TEST_ASSERT(dense.total() < sparse.total());
+}
+
 // ----------------------------------------------------------------------------
 } 